@@ -7,7 +7,12 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <learnopengl/shader.h>
+#include <rg/GLStateCache.h>
+#include <rg/RenderStats.h>
+#include <rg/ShaderVariants.h>
 
+#include <algorithm>
+#include <array>
 #include <string>
 #include <vector>
 using namespace std;
@@ -33,6 +38,94 @@ struct Texture {
     string path;
 };
 
+// The textures of a mesh laid out on fixed texture units, built once when the mesh is loaded.
+// Every material sampler has its own unit (texture_diffuse1 -> 0, texture_specular1 -> 1, ...),
+// so a shader's samplers are pointed at the units once and drawing only binds textures.
+class Material {
+public:
+    enum Unit { DIFFUSE = 0, SPECULAR, NORMAL, HEIGHT, NUM_UNITS };
+
+    // texture of each unit, 0 where the mesh has no texture of that type
+    std::array<unsigned int, NUM_UNITS> textures;
+    // hashed prefix + sampler name of each unit
+    std::array<UniformId, NUM_UNITS> samplerNames;
+
+    explicit Material(const vector<Texture> &meshTextures, const std::string &prefix = "")
+            : samplerNames(hashSamplerNames(prefix))
+    {
+        textures.fill(0);
+        for (const Texture &texture : meshTextures)
+        {
+            int unit = unitOf(texture.type);
+            // only the first texture of each type has a sampler in our shaders
+            if (unit >= 0 && textures[unit] == 0)
+                textures[unit] = texture.id;
+        }
+    }
+
+    void setPrefix(const std::string &prefix)
+    {
+        samplerNames = hashSamplerNames(prefix);
+        resolvedPrograms.clear();
+    }
+
+    // binds the textures; shader must be in use, its samplers are set the first time it is seen
+    void bind(Shader &shader)
+    {
+        if (std::find(resolvedPrograms.begin(), resolvedPrograms.end(), shader.programSerial()) == resolvedPrograms.end())
+        {
+            for (unsigned int unit = 0; unit < NUM_UNITS; unit++)
+                shader.setInt(samplerNames[unit], unit);
+            resolvedPrograms.push_back(shader.programSerial());
+        }
+        for (unsigned int unit = 0; unit < NUM_UNITS; unit++)
+            if (textures[unit])
+                glState().bindTexture(unit, GL_TEXTURE_2D, textures[unit]);
+    }
+
+    // shader variant features the textures need, see ShaderVariants
+    unsigned int features() const
+    {
+        return textures[SPECULAR] ? ShaderVariants::HAS_SPECULAR_MAP : 0;
+    }
+
+    // orders materials so the ones drawn with the same shader variant, then the ones sharing
+    // textures, end up next to each other
+    bool operator<(const Material &other) const
+    {
+        if (features() != other.features())
+            return features() < other.features();
+        return textures < other.textures;
+    }
+
+    static int unitOf(const std::string &type)
+    {
+        if (type == "texture_diffuse")
+            return DIFFUSE;
+        if (type == "texture_specular")
+            return SPECULAR;
+        if (type == "texture_normal")
+            return NORMAL;
+        if (type == "texture_height")
+            return HEIGHT;
+        return -1;
+    }
+
+private:
+    // serials of the programs whose samplers already point at our units, a reloaded program is a new one
+    vector<unsigned long long> resolvedPrograms;
+
+    static std::array<UniformId, NUM_UNITS> hashSamplerNames(const std::string &prefix)
+    {
+        return {{
+            UniformId(uniformHash((prefix + "texture_diffuse1").c_str())),
+            UniformId(uniformHash((prefix + "texture_specular1").c_str())),
+            UniformId(uniformHash((prefix + "texture_normal1").c_str())),
+            UniformId(uniformHash((prefix + "texture_height1").c_str()))
+        }};
+    }
+};
+
 class Mesh {
 public:
     // mesh Data
@@ -40,10 +133,17 @@ public:
     vector<unsigned int> indices;
     vector<Texture>      textures;
 
+    Material material;
+
     unsigned int VAO;
     std::string glslIdentifierPrefix;
+
+    // where the mesh lives inside a StaticDrawList's shared buffers, and which texture set it uses
+    unsigned int poolFirstIndex = 0;
+    int poolBaseVertex = 0;
+    unsigned int materialIndex = 0;
     // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures) : material(textures)
     {
         this->vertices = vertices;
         this->indices = indices;
@@ -56,41 +156,38 @@ public:
     // render the mesh
     void Draw(Shader &shader)
     {
-        // bind appropriate textures
-        unsigned int diffuseNr  = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr   = 1;
-        unsigned int heightNr   = 1;
-        for(unsigned int i = 0; i < textures.size(); i++)
-        {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
-            if(name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if(name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to stream
-            else if(name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to stream
-            else if(name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to stream
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (glslIdentifierPrefix + name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
-        }
+        bindTextures(shader);
+        DrawGeometry();
+    }
 
+    // draws the mesh without touching textures, for passes that only need depth
+    void DrawGeometry()
+    {
+        // the VAO and textures stay bound so the next draw of the same mesh binds nothing
+        glState().bindVertexArray(VAO);
+        renderStats().drawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    }
 
+    // binds the textures of the mesh and points the shader's samplers at them
+    void bindTextures(Shader &shader)
+    {
+        material.bind(shader);
+    }
 
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+    // sets the prefix of the sampler names in the shader, e.g. "material." for material.texture_diffuse1
+    void setGlslIdentifierPrefix(const std::string &prefix)
+    {
+        glslIdentifierPrefix = prefix;
+        material.setPrefix(prefix);
+    }
 
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+    // deletes the buffers of the mesh, it can't be drawn afterwards
+    void release()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        VAO = VBO = EBO = 0;
     }
 
 private:
@@ -105,16 +202,18 @@ private:
         glGenBuffers(1, &VBO);
         glGenBuffers(1, &EBO);
 
-        glBindVertexArray(VAO);
+        glState().bindVertexArray(VAO);
         // load data into vertex buffers
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
         glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        renderStats().bufferUpload(vertices.size() * sizeof(Vertex));
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        renderStats().bufferUpload(indices.size() * sizeof(unsigned int));
 
         // set the vertex attribute pointers
         // vertex Positions
@@ -133,7 +232,7 @@ private:
         glEnableVertexAttribArray(4);
         glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
 
-        glBindVertexArray(0);
+        glState().bindVertexArray(0);
     }
 };
 #endif
\ No newline at end of file
@@ -12,16 +12,20 @@
 
 #include <learnopengl/mesh.h>
 #include <learnopengl/shader.h>
+#include <rg/CpuProfiler.h>
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
 #include <map>
+#include <limits>
 #include <vector>
 using namespace std;
 
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
+bool LoadTextureFile(unsigned int textureID, const string &filename);
 
 
 
@@ -31,11 +35,17 @@ public:
     // model data
     vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
     vector<Mesh>    meshes;
+    string path;
     string directory;
     bool gammaCorrection;
+    // meshes sorted by material, so meshes with the same textures are drawn back to back
+    vector<unsigned int> drawOrder;
+    // axis aligned bounding box of all meshes, in model space
+    glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax = glm::vec3(-std::numeric_limits<float>::max());
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model(string const &path, bool gamma = false) : path(path), gammaCorrection(gamma)
     {
         loadModel(path);
     }
@@ -43,19 +53,72 @@ public:
     // draws the model, and thus all its meshes
     void Draw(Shader &shader)
     {
-        for(unsigned int i = 0; i < meshes.size(); i++)
+        PROFILE_SCOPE("Model::Draw");
+        for(unsigned int i : drawOrder)
+            meshes[i].Draw(shader);
+    }
+
+    // draws every mesh with the variant its material needs, on top of features; transform is set
+    // as the model matrix of each variant used
+    void Draw(ShaderVariants &variants, unsigned int features, const glm::mat4 &transform)
+    {
+        PROFILE_SCOPE("Model::Draw");
+        Shader *current = nullptr;
+        for(unsigned int i : drawOrder)
+        {
+            Shader &shader = variants.get(features | meshes[i].material.features());
+            if (&shader != current)
+            {
+                shader.use();
+                shader.setMat4("model"_uniform, transform);
+                current = &shader;
+            }
             meshes[i].Draw(shader);
+        }
+    }
+
+    // draws all meshes without their textures
+    void DrawGeometry()
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].DrawGeometry();
     }
 
     void SetShaderTextureNamePrefix(std::string prefix) {
+        textureNamePrefix = prefix;
         for (Mesh& mesh: meshes) {
-            mesh.glslIdentifierPrefix = prefix;
+            mesh.setGlslIdentifierPrefix(prefix);
         }
     }
+    // imports the file again. The new meshes and textures replace the current ones only when the import
+    // produced any, so a broken file leaves the model as it was
+    bool Reload()
+    {
+        Model reloaded(path, gammaCorrection);
+        if (reloaded.meshes.empty())
+            return false;
+        for (Mesh &mesh : meshes)
+            mesh.release();
+        for (Texture &texture : textures_loaded)
+            glDeleteTextures(1, &texture.id);
+        meshes.swap(reloaded.meshes);
+        textures_loaded.swap(reloaded.textures_loaded);
+        drawOrder.swap(reloaded.drawOrder);
+        directory = reloaded.directory;
+        boundsMin = reloaded.boundsMin;
+        boundsMax = reloaded.boundsMax;
+        if (!textureNamePrefix.empty())
+            SetShaderTextureNamePrefix(textureNamePrefix);
+        return true;
+    }
+
 private:
+    string textureNamePrefix;
+
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
     void loadModel(string const &path)
     {
+        PROFILE_SCOPE("Model::loadModel");
         // read file via ASSIMP
         Assimp::Importer importer;
         const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
@@ -70,6 +133,12 @@ private:
 
         // process ASSIMP's root node recursively
         processNode(scene->mRootNode, scene);
+
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            drawOrder.push_back(i);
+        std::stable_sort(drawOrder.begin(), drawOrder.end(), [this](unsigned int a, unsigned int b) {
+            return meshes[a].material < meshes[b].material;
+        });
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
@@ -108,6 +177,8 @@ private:
             vector.y = mesh->mVertices[i].y;
             vector.z = mesh->mVertices[i].z;
             vertex.Position = vector;
+            boundsMin = glm::min(boundsMin, vector);
+            boundsMax = glm::max(boundsMax, vector);
             // normals
             if (mesh->HasNormals())
             {
@@ -224,9 +295,21 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
 
     unsigned int textureID;
     glGenTextures(1, &textureID);
+    if (!LoadTextureFile(textureID, filename))
+        std::cout << "Texture failed to load at path: " << path << std::endl;
 
+    return textureID;
+}
+
+// decodes the image file into the texture, which keeps its old contents if that fails
+bool LoadTextureFile(unsigned int textureID, const string &filename)
+{
     int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
+    unsigned char *data;
+    {
+        PROFILE_SCOPE("texture decode");
+        data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
+    }
     if (data)
     {
         GLenum format;
@@ -237,8 +320,9 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
         else if (nrComponents == 4)
             format = GL_RGBA;
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
+        glState().bindTexture(0, GL_TEXTURE_2D, textureID);
         glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        renderStats().bufferUpload((unsigned long long) width * height * nrComponents);
         glGenerateMipmap(GL_TEXTURE_2D);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -247,13 +331,9 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
         stbi_image_free(data);
+        return true;
     }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
+    stbi_image_free(data);
+    return false;
 }
 #endif
@@ -4,11 +4,46 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <chrono>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
 #include <common.h>
+#include <rg/CpuProfiler.h>
+#include <rg/GLStateCache.h>
+#include <rg/RenderStats.h>
+#include <rg/ProgramBinaryCache.h>
+
+// 32 bit FNV-1a hash of a uniform name, usable in constant expressions
+constexpr std::uint32_t uniformHash(const char *name)
+{
+    std::uint32_t hash = 2166136261u;
+    while (*name)
+    {
+        hash ^= (unsigned char) *name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// a uniform name reduced to its hash. "model"_uniform is a constant expression: stored in a
+// constexpr UniformId it is hashed at compile time, passed straight to a setter optimisers fold it
+// but nothing requires them to
+struct UniformId
+{
+    std::uint32_t hash;
+    constexpr explicit UniformId(std::uint32_t hash) : hash(hash) {}
+};
+
+constexpr UniformId operator"" _uniform(const char *name, std::size_t)
+{
+    return UniformId(uniformHash(name));
+}
+
 class Shader
 {
 public:
@@ -16,9 +51,23 @@ public:
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+            : Shader(vertexPath, fragmentPath, std::vector<std::string>(), geometryPath)
+    {
+    }
+    // same, every stage is compiled with the defines ("NAME" or "NAME VALUE") right after its #version line.
+    // Without waitForLink the compile and link are only submitted, so the driver can work on several
+    // programs at once; poll linkCompleted() and call finishLink() before using the program
+    // ------------------------------------------------------------------------
+    Shader(const char* vertexPath, const char* fragmentPath, const std::vector<std::string> &defines,
+           const char* geometryPath = nullptr, bool waitForLink = true)
     {
+        PROFILE_SCOPE("shader build");
         std::string vertexPathString(vertexPath);
         std::string fragmentPathString(fragmentPath);
+        sourceFiles = {vertexPathString, fragmentPathString};
+        if(geometryPath != nullptr)
+            sourceFiles.push_back(geometryPath);
+        sourceDefines = defines;
 
         vertexPath = vertexPathString.c_str();
         fragmentPath= fragmentPathString.c_str();
@@ -64,111 +113,473 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
         }
+        vertexCode = injectDefines(vertexCode, defines);
+        fragmentCode = injectDefines(fragmentCode, defines);
+        geometryCode = injectDefines(geometryCode, defines);
+        // 2. load the linked program from the binary cache when an earlier run stored it
+        cacheKey = ProgramBinaryCache::key({vertexCode, fragmentCode, geometryCode});
+        auto start = std::chrono::steady_clock::now();
+        ID = glCreateProgram();
+        serial = nextSerial();
+        if (programBinaryCache().load(ID, cacheKey))
+        {
+            programBinaryCache().loaded(millisecondsSince(start));
+            linked = true;
+            reflectUniforms();
+            return;
+        }
         const char* vShaderCode = vertexCode.c_str();
         const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
+        // 3. compile shaders, their status is only asked for in finishLink() so nothing waits for the driver here
         // vertex shader
         vertex = glCreateShader(GL_VERTEX_SHADER);
         glShaderSource(vertex, 1, &vShaderCode, NULL);
         glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
         // fragment Shader
         fragment = glCreateShader(GL_FRAGMENT_SHADER);
         glShaderSource(fragment, 1, &fShaderCode, NULL);
         glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
         // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
         if(geometryPath != nullptr)
         {
             const char * gShaderCode = geometryCode.c_str();
             geometry = glCreateShader(GL_GEOMETRY_SHADER);
             glShaderSource(geometry, 1, &gShaderCode, NULL);
             glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
         }
         // shader Program
-        ID = glCreateProgram();
         glAttachShader(ID, vertex);
         glAttachShader(ID, fragment);
-        if(geometryPath != nullptr)
+        if(geometry)
             glAttachShader(ID, geometry);
+        programBinaryCache().prepare(ID);
         glLinkProgram(ID);
+        linking = true;
+        linkMilliseconds = millisecondsSince(start);
+        if (waitForLink)
+            finishLink();
+    }
+    // false while an asynchronous link is still running in the driver; always true without
+    // parallel shader compile, finishLink() then waits for it instead
+    // ------------------------------------------------------------------------
+    bool linkCompleted() const
+    {
+        if (!linking || !glExtensions().parallelShaderCompile)
+            return true;
+        GLint completed = GL_FALSE;
+        glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &completed);
+        return completed == GL_TRUE;
+    }
+    bool isLinking() const
+    {
+        return linking;
+    }
+    // reports compile and link errors, stores the binary and reflects the uniforms once the link is done
+    // ------------------------------------------------------------------------
+    void finishLink()
+    {
+        if (!linking)
+            return;
+        PROFILE_SCOPE("shader link");
+        linking = false;
+        auto start = std::chrono::steady_clock::now();
+        checkCompileErrors(vertex, "VERTEX");
+        checkCompileErrors(fragment, "FRAGMENT");
+        if(geometry)
+            checkCompileErrors(geometry, "GEOMETRY");
         checkCompileErrors(ID, "PROGRAM");
+        GLint linkStatus = GL_FALSE;
+        glGetProgramiv(ID, GL_LINK_STATUS, &linkStatus);
+        linked = linkStatus == GL_TRUE;
+        // what the calling thread spent on the program, waiting included; a cache hit saves that
+        linkMilliseconds += millisecondsSince(start);
+        if (linked)
+            programBinaryCache().store(ID, cacheKey, linkMilliseconds);
+        reflectUniforms();
         // delete the shaders as they're linked into our program now and no longer necessery
         glDeleteShader(vertex);
         glDeleteShader(fragment);
-        if(geometryPath != nullptr)
+        if(geometry)
             glDeleteShader(geometry);
-
+        vertex = fragment = geometry = 0;
+    }
+    // the vertex, fragment and (if any) geometry shader file the program is built from
+    // ------------------------------------------------------------------------
+    const std::vector<std::string> &files() const
+    {
+        return sourceFiles;
+    }
+    bool usesFile(const std::string &path) const
+    {
+        for (const std::string &file : sourceFiles)
+            if (file == path)
+                return true;
+        return false;
+    }
+    // builds the program again from its files. The new program only replaces the current one when it
+    // links, and takes over its uniform values and block bindings, so everything holding this Shader
+    // keeps working and a broken edit leaves the last good version running
+    // ------------------------------------------------------------------------
+    bool reload()
+    {
+        finishLink();
+        Shader candidate(sourceFiles[0].c_str(), sourceFiles[1].c_str(), sourceDefines,
+                         sourceFiles.size() > 2 ? sourceFiles[2].c_str() : nullptr);
+        if (!candidate.linked)
+        {
+            glDeleteProgram(candidate.ID);
+            return false;
+        }
+        candidate.copyStateFrom(*this);
+        glDeleteProgram(ID);
+        ID = candidate.ID;
+        serial = candidate.serial;
+        linked = true;
+        cacheKey = candidate.cacheKey;
+        uniformLocations.swap(candidate.uniformLocations);
+        // the deleted program may still be the current one in the state cache
+        glState().invalidate();
+        return true;
+    }
+    // tells programs apart where ID can't: GL hands out the names of deleted programs again, the
+    // serial of every program built in a run is new, including the one reload() swaps in
+    // ------------------------------------------------------------------------
+    unsigned long long programSerial() const
+    {
+        return serial;
     }
     // activate the shader
     // ------------------------------------------------------------------------
     void use() 
     { 
-        glUseProgram(ID); 
+        glState().useProgram(ID);
     }
-    // utility uniform functions
+    // connects a uniform block to a binding point, does nothing if the program has no such block
+    // ------------------------------------------------------------------------
+    void bindUniformBlock(const std::string &name, unsigned int binding) const
+    {
+        unsigned int index = glGetUniformBlockIndex(ID, name.c_str());
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, index, binding);
+    }
+    // location of an active uniform, -1 (ignored by glUniform*) if the program doesn't use it
+    // ------------------------------------------------------------------------
+    GLint uniformLocation(UniformId id) const
+    {
+        auto location = uniformLocations.find(id.hash);
+        return location == uniformLocations.end() ? -1 : location->second;
+    }
+    GLint uniformLocation(const std::string &name) const
+    {
+        return uniformLocation(UniformId(uniformHash(name.c_str())));
+    }
+    // utility uniform functions, each takes a name, a hashed name or a location from uniformLocation()
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        setBool(uniformLocation(name), value);
+    }
+    void setBool(UniformId id, bool value) const
+    {
+        setBool(uniformLocation(id), value);
+    }
+    void setBool(GLint location, bool value) const
+    {
+        glUniform1i(location, (int)value);
+        renderStats().uniformUpload(sizeof(int));
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        setInt(uniformLocation(name), value);
+    }
+    void setInt(UniformId id, int value) const
+    {
+        setInt(uniformLocation(id), value);
+    }
+    void setInt(GLint location, int value) const
+    {
+        glUniform1i(location, value);
+        renderStats().uniformUpload(sizeof(int));
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        setFloat(uniformLocation(name), value);
+    }
+    void setFloat(UniformId id, float value) const
+    {
+        setFloat(uniformLocation(id), value);
+    }
+    void setFloat(GLint location, float value) const
+    {
+        glUniform1f(location, value);
+        renderStats().uniformUpload(sizeof(float));
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        setVec2(uniformLocation(name), value);
+    }
+    void setVec2(UniformId id, const glm::vec2 &value) const
+    {
+        setVec2(uniformLocation(id), value);
+    }
+    void setVec2(GLint location, const glm::vec2 &value) const
+    {
+        glUniform2fv(location, 1, &value[0]);
+        renderStats().uniformUpload(sizeof(value));
     }
     void setVec2(const std::string &name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        glUniform2f(uniformLocation(name), x, y);
+        renderStats().uniformUpload(2 * sizeof(float));
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        setVec3(uniformLocation(name), value);
+    }
+    void setVec3(UniformId id, const glm::vec3 &value) const
+    {
+        setVec3(uniformLocation(id), value);
+    }
+    void setVec3(GLint location, const glm::vec3 &value) const
+    {
+        glUniform3fv(location, 1, &value[0]);
+        renderStats().uniformUpload(sizeof(value));
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        glUniform3f(uniformLocation(name), x, y, z);
+        renderStats().uniformUpload(3 * sizeof(float));
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        setVec4(uniformLocation(name), value);
+    }
+    void setVec4(UniformId id, const glm::vec4 &value) const
+    {
+        setVec4(uniformLocation(id), value);
+    }
+    void setVec4(GLint location, const glm::vec4 &value) const
+    {
+        glUniform4fv(location, 1, &value[0]);
+        renderStats().uniformUpload(sizeof(value));
     }
     void setVec4(const std::string &name, float x, float y, float z, float w) 
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        glUniform4f(uniformLocation(name), x, y, z, w);
+        renderStats().uniformUpload(4 * sizeof(float));
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat2(uniformLocation(name), mat);
+    }
+    void setMat2(UniformId id, const glm::mat2 &mat) const
+    {
+        setMat2(uniformLocation(id), mat);
+    }
+    void setMat2(GLint location, const glm::mat2 &mat) const
+    {
+        glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
+        renderStats().uniformUpload(sizeof(mat));
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat3(uniformLocation(name), mat);
+    }
+    void setMat3(UniformId id, const glm::mat3 &mat) const
+    {
+        setMat3(uniformLocation(id), mat);
+    }
+    void setMat3(GLint location, const glm::mat3 &mat) const
+    {
+        glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+        renderStats().uniformUpload(sizeof(mat));
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat4(uniformLocation(name), mat);
+    }
+    void setMat4(UniformId id, const glm::mat4 &mat) const
+    {
+        setMat4(uniformLocation(id), mat);
+    }
+    void setMat4(GLint location, const glm::mat4 &mat) const
+    {
+        glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
+        renderStats().uniformUpload(sizeof(mat));
     }
 
 private:
+    // stages of a link that hasn't been finished yet
+    unsigned int vertex = 0, fragment = 0, geometry = 0;
+    bool linking = false;
+    bool linked = false;
+    unsigned long long serial = 0;
+    std::string cacheKey;
+    std::vector<std::string> sourceFiles;
+    std::vector<std::string> sourceDefines;
+    double linkMilliseconds = 0.0;
+    // name hash -> location of every active uniform outside of uniform blocks
+    std::unordered_map<std::uint32_t, GLint> uniformLocations;
+
+    static unsigned long long nextSerial()
+    {
+        static unsigned long long count = 0;
+        return ++count;
+    }
+
+    // asks the linked program for its active uniforms once, so setting a uniform never has to call glGetUniformLocation
+    // ------------------------------------------------------------------------
+    void reflectUniforms()
+    {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> buffer(maxLength + 1);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type;
+            glGetActiveUniform(ID, i, (GLsizei) buffer.size(), &length, &size, &type, buffer.data());
+            std::string name(buffer.data(), length);
+            GLint location = glGetUniformLocation(ID, name.c_str());
+            // members of uniform blocks have no location
+            if (location < 0)
+                continue;
+
+            // arrays of basic types are reported once as "name[0]", register "name" and every element
+            const std::string arraySuffix = "[0]";
+            if (name.size() > arraySuffix.size() && name.compare(name.size() - arraySuffix.size(), arraySuffix.size(), arraySuffix) == 0)
+            {
+                std::string base = name.substr(0, name.size() - arraySuffix.size());
+                addUniform(base, location);
+                for (GLint element = 0; element < size; element++)
+                {
+                    std::string elementName = base + "[" + std::to_string(element) + "]";
+                    addUniform(elementName, glGetUniformLocation(ID, elementName.c_str()));
+                }
+            }
+            else
+                addUniform(name, location);
+        }
+    }
+    // ------------------------------------------------------------------------
+    void addUniform(const std::string &name, GLint location)
+    {
+        auto inserted = uniformLocations.insert(std::make_pair(uniformHash(name.c_str()), location));
+        if (!inserted.second && inserted.first->second != location)
+            std::cout << "ERROR::SHADER::UNIFORM_HASH_COLLISION: " << name << std::endl;
+    }
+    // sets the uniforms and uniform block bindings this program shares with old to the values they have there
+    // ------------------------------------------------------------------------
+    void copyStateFrom(const Shader &old)
+    {
+        glState().useProgram(ID);
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> buffer(maxLength + 1);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type;
+            glGetActiveUniform(ID, i, (GLsizei) buffer.size(), &length, &size, &type, buffer.data());
+            std::string name(buffer.data(), length);
+            const std::string arraySuffix = "[0]";
+            bool array = name.size() > arraySuffix.size() && name.compare(name.size() - arraySuffix.size(), arraySuffix.size(), arraySuffix) == 0;
+            std::string base = array ? name.substr(0, name.size() - arraySuffix.size()) : name;
+            for (GLint element = 0; element < size; element++)
+            {
+                std::string elementName = array ? base + "[" + std::to_string(element) + "]" : name;
+                GLint location = glGetUniformLocation(ID, elementName.c_str());
+                GLint oldLocation = glGetUniformLocation(old.ID, elementName.c_str());
+                if (location >= 0 && oldLocation >= 0)
+                    copyUniform(old.ID, oldLocation, location, type);
+            }
+        }
+
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+        buffer.resize(maxLength + 1);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            glGetActiveUniformBlockName(ID, i, (GLsizei) buffer.size(), &length, buffer.data());
+            GLuint oldIndex = glGetUniformBlockIndex(old.ID, buffer.data());
+            if (oldIndex == GL_INVALID_INDEX)
+                continue;
+            GLint binding = 0;
+            glGetActiveUniformBlockiv(old.ID, oldIndex, GL_UNIFORM_BLOCK_BINDING, &binding);
+            glUniformBlockBinding(ID, i, binding);
+        }
+    }
+    // copies one uniform of the current program from another program, types GLSL 330 can't have as
+    // a plain uniform are left alone
+    // ------------------------------------------------------------------------
+    static void copyUniform(GLuint from, GLint fromLocation, GLint location, GLenum type)
+    {
+        GLfloat floats[16];
+        GLint ints[4];
+        GLuint uints[4];
+        switch (type)
+        {
+        case GL_FLOAT: glGetUniformfv(from, fromLocation, floats); glUniform1fv(location, 1, floats); break;
+        case GL_FLOAT_VEC2: glGetUniformfv(from, fromLocation, floats); glUniform2fv(location, 1, floats); break;
+        case GL_FLOAT_VEC3: glGetUniformfv(from, fromLocation, floats); glUniform3fv(location, 1, floats); break;
+        case GL_FLOAT_VEC4: glGetUniformfv(from, fromLocation, floats); glUniform4fv(location, 1, floats); break;
+        case GL_FLOAT_MAT2: glGetUniformfv(from, fromLocation, floats); glUniformMatrix2fv(location, 1, GL_FALSE, floats); break;
+        case GL_FLOAT_MAT3: glGetUniformfv(from, fromLocation, floats); glUniformMatrix3fv(location, 1, GL_FALSE, floats); break;
+        case GL_FLOAT_MAT4: glGetUniformfv(from, fromLocation, floats); glUniformMatrix4fv(location, 1, GL_FALSE, floats); break;
+        case GL_INT_VEC2: case GL_BOOL_VEC2: glGetUniformiv(from, fromLocation, ints); glUniform2iv(location, 1, ints); break;
+        case GL_INT_VEC3: case GL_BOOL_VEC3: glGetUniformiv(from, fromLocation, ints); glUniform3iv(location, 1, ints); break;
+        case GL_INT_VEC4: case GL_BOOL_VEC4: glGetUniformiv(from, fromLocation, ints); glUniform4iv(location, 1, ints); break;
+        case GL_UNSIGNED_INT: glGetUniformuiv(from, fromLocation, uints); glUniform1uiv(location, 1, uints); break;
+        case GL_UNSIGNED_INT_VEC2: glGetUniformuiv(from, fromLocation, uints); glUniform2uiv(location, 1, uints); break;
+        case GL_UNSIGNED_INT_VEC3: glGetUniformuiv(from, fromLocation, uints); glUniform3uiv(location, 1, uints); break;
+        case GL_UNSIGNED_INT_VEC4: glGetUniformuiv(from, fromLocation, uints); glUniform4uiv(location, 1, uints); break;
+        // ints, bools and the texture unit of every sampler type the shaders use
+        case GL_INT: case GL_BOOL:
+        case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE: case GL_SAMPLER_2D_SHADOW:
+        case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_2D_ARRAY_SHADOW: case GL_SAMPLER_BUFFER:
+        case GL_SAMPLER_2D_MULTISAMPLE: case GL_INT_SAMPLER_BUFFER: case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+            glGetUniformiv(from, fromLocation, ints);
+            glUniform1iv(location, 1, ints);
+            break;
+        default:
+            break;
+        }
+    }
+    // ------------------------------------------------------------------------
+    static double millisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    // inserts a #define for each entry after the #version line, which has to stay the first line
+    // ------------------------------------------------------------------------
+    static std::string injectDefines(const std::string &code, const std::vector<std::string> &defines)
+    {
+        if (defines.empty() || code.empty())
+            return code;
+        std::string block;
+        for (const std::string &define : defines)
+            block += "#define " + define + "\n";
+        std::size_t version = code.find("#version");
+        std::size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+        if (version == std::string::npos)
+            return block + code;
+        if (lineEnd == std::string::npos)
+            return code + "\n" + block;
+        return code.substr(0, lineEnd + 1) + block + code.substr(lineEnd + 1);
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
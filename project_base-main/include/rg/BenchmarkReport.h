@@ -0,0 +1,226 @@
+#ifndef PROJECT_BASE_BENCHMARKREPORT_H
+#define PROJECT_BASE_BENCHMARKREPORT_H
+
+#include <rg/FrameTimes.h>
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+// Result of a benchmark run as JSON: the frame time summaries on the CPU and the GPU and the
+// thresholds a later run is held to. A run saved as the baseline is what compare() reads back;
+// a metric passes while it stays under the baseline times its threshold, so 1.10 allows 10% more.
+// Thresholds in the baseline file win over the defaults, max is only checked when it has one.
+class BenchmarkReport {
+public:
+    BenchmarkReport(const std::string &name, int width, int height, const FrameTimes &cpu, const FrameTimes &gpu)
+            : name(name), width(width), height(height), cpu(cpu.summary()), gpu(gpu.summary()) {
+        thresholds["average"] = 1.10;
+        thresholds["p50"] = 1.10;
+        thresholds["p95"] = 1.20;
+        thresholds["p99"] = 1.30;
+    }
+
+    bool write(const std::string &path) const {
+        std::ofstream file(path);
+        if (!file) {
+            std::cout << "ERROR::BENCHMARK::CANNOT_WRITE_REPORT: " << path << std::endl;
+            return false;
+        }
+        file << "{\n  \"name\": \"" << escaped(name) << "\",\n  \"width\": " << width << ",\n  \"height\": " << height
+             << ",\n  \"frames\": " << cpu.count << ",\n";
+        writeSummary(file, "cpu", cpu);
+        file << ",\n";
+        writeSummary(file, "gpu", gpu);
+        file << ",\n  \"thresholds\": {";
+        const char *separator = "";
+        for (const std::pair<const std::string, double> &threshold : thresholds) {
+            file << separator << "\n    \"" << threshold.first << "\": " << number(threshold.second);
+            separator = ",";
+        }
+        file << "\n  }\n}\n";
+        std::cout << "benchmark: report written to " << path << std::endl;
+        return true;
+    }
+
+    // prints every metric against the baseline, false when one of them is over its threshold
+    // or the baseline can't be read
+    bool compare(const std::string &baselinePath) const {
+        std::ifstream file(baselinePath);
+        if (!file) {
+            std::cout << "ERROR::BENCHMARK::CANNOT_OPEN_BASELINE: " << baselinePath << std::endl;
+            return false;
+        }
+        std::stringstream text;
+        text << file.rdbuf();
+        std::map<std::string, double> baseline;
+        if (!JsonNumbers(text.str(), baseline).parse()) {
+            std::cout << "ERROR::BENCHMARK::BAD_BASELINE: " << baselinePath << std::endl;
+            return false;
+        }
+        std::map<std::string, double> limits = thresholds;
+        for (const std::pair<const std::string, double> &value : baseline)
+            if (value.first.compare(0, 11, "thresholds.") == 0)
+                limits[value.first.substr(11)] = value.second;
+        if (baseline.count("width") && baseline.count("height") &&
+            (baseline["width"] != width || baseline["height"] != height))
+            std::cout << "benchmark: baseline was " << baseline["width"] << 'x' << baseline["height"]
+                      << ", this run " << width << 'x' << height << std::endl;
+
+        bool passed = true;
+        const char *metrics[] = {"average", "p50", "p95", "p99", "max"};
+        for (const char *clock : {"cpu", "gpu"}) {
+            const FrameTimes::Summary &summary = std::string(clock) == "cpu" ? cpu : gpu;
+            // the GPU has no times without timer queries, there is nothing to hold it to
+            if (summary.count == 0)
+                continue;
+            for (const char *metric : metrics) {
+                std::string key = std::string(clock) + "." + metric;
+                if (!limits.count(metric) || !baseline.count(key))
+                    continue;
+                double current = value(summary, metric), before = baseline[key], limit = before * limits[metric];
+                bool ok = current <= limit;
+                passed = passed && ok;
+                std::printf("  %-12s %8.3f ms, baseline %8.3f, limit %8.3f  %s\n", key.c_str(), current, before, limit,
+                            ok ? "ok" : "FAIL");
+            }
+        }
+        std::cout << "benchmark: " << (passed ? "passed" : "FAILED") << " against " << baselinePath << std::endl;
+        return passed;
+    }
+
+private:
+    std::string name;
+    int width, height;
+    FrameTimes::Summary cpu, gpu;
+    std::map<std::string, double> thresholds;
+
+    static double value(const FrameTimes::Summary &summary, const std::string &metric) {
+        if (metric == "average") return summary.average;
+        if (metric == "p50") return summary.p50;
+        if (metric == "p95") return summary.p95;
+        if (metric == "p99") return summary.p99;
+        return summary.max;
+    }
+
+    static std::string number(double value) {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.4f", value);
+        return text;
+    }
+
+    static void writeSummary(std::ofstream &file, const char *clock, const FrameTimes::Summary &summary) {
+        file << "  \"" << clock << "\": {\n    \"average\": " << number(summary.average) << ",\n    \"p50\": "
+             << number(summary.p50) << ",\n    \"p95\": " << number(summary.p95) << ",\n    \"p99\": "
+             << number(summary.p99) << ",\n    \"max\": " << number(summary.max) << "\n  }";
+    }
+
+    static std::string escaped(const std::string &text) {
+        std::string result;
+        for (char c : text) {
+            if (c == '"' || c == '\\')
+                result += '\\';
+            result += c;
+        }
+        return result;
+    }
+
+    // just enough JSON for a report: every number under an object goes into the map by its path of
+    // keys joined with dots, strings, booleans and null are read and left out
+    class JsonNumbers {
+    public:
+        JsonNumbers(const std::string &text, std::map<std::string, double> &numbers) : text(text), numbers(numbers) {}
+
+        bool parse() {
+            return value("") && (skipSpace(), at == text.size());
+        }
+
+    private:
+        const std::string &text;
+        std::map<std::string, double> &numbers;
+        std::size_t at = 0;
+
+        void skipSpace() {
+            while (at < text.size() && std::isspace((unsigned char) text[at]))
+                at++;
+        }
+
+        bool consume(char c) {
+            skipSpace();
+            if (at < text.size() && text[at] == c) {
+                at++;
+                return true;
+            }
+            return false;
+        }
+
+        bool string(std::string &result) {
+            if (!consume('"'))
+                return false;
+            while (at < text.size() && text[at] != '"') {
+                if (text[at] == '\\' && ++at == text.size())
+                    return false;
+                result += text[at++];
+            }
+            return consume('"');
+        }
+
+        bool literal(const char *word) {
+            std::string expected(word);
+            if (text.compare(at, expected.size(), expected) != 0)
+                return false;
+            at += expected.size();
+            return true;
+        }
+
+        bool value(const std::string &path) {
+            skipSpace();
+            if (at == text.size())
+                return false;
+            char c = text[at];
+            if (c == '{') {
+                at++;
+                if (consume('}'))
+                    return true;
+                do {
+                    std::string key;
+                    if (!string(key) || !consume(':') || !value(path.empty() ? key : path + "." + key))
+                        return false;
+                } while (consume(','));
+                return consume('}');
+            }
+            if (c == '[') {
+                at++;
+                if (consume(']'))
+                    return true;
+                do {
+                    if (!value(path + "[]"))
+                        return false;
+                } while (consume(','));
+                return consume(']');
+            }
+            if (c == '"') {
+                std::string ignored;
+                return string(ignored);
+            }
+            if (c == 't' || c == 'f' || c == 'n')
+                return literal("true") || literal("false") || literal("null");
+            const char *begin = text.c_str() + at;
+            char *end;
+            double number = std::strtod(begin, &end);
+            if (end == begin)
+                return false;
+            at += end - begin;
+            if (!path.empty())
+                numbers[path] = number;
+            return true;
+        }
+    };
+};
+
+#endif //PROJECT_BASE_BENCHMARKREPORT_H
@@ -0,0 +1,289 @@
+#ifndef PROJECT_BASE_CLUSTEREDLIGHTS_H
+#define PROJECT_BASE_CLUSTEREDLIGHTS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+#include <rg/CpuProfiler.h>
+#include <rg/GLExtensions.h>
+#include <rg/GLStateCache.h>
+#include <rg/RenderStats.h>
+#include <rg/StreamBuffer.h>
+#include <rg/ThreadPool.h>
+#include <rg/UniformBuffers.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Clustered forward shading: the view frustum is split into GRID_X x GRID_Y screen tiles and
+// GRID_Z depth slices, exponentially spaced between the near and far plane, and every frame each
+// point light is assigned to the clusters its pointLightRadius() sphere touches. The slices are
+// filled in parallel on the thread pool. Fragment shaders look up the cluster of their pixel and
+// depth and only loop over the lights listed for it, however many lights the scene has.
+// The lights, the (offset, count) of every cluster and the light indices go to the shaders as
+// buffer textures, the grid parameters through the Clusters uniform block. The ranges, indices and
+// block are rewritten every frame into the StreamBuffer. Buffer textures only reach
+// GL_MAX_TEXTURE_BUFFER_SIZE texels (65536 guaranteed), so with GL 4.3 or ARB_texture_buffer_range
+// the ranges and indices textures are pointed at this frame's lists alone. Without it they view
+// the whole stream buffer, the block carries where this frame's ranges start and the ranges hold
+// absolute texels of the indices; a stream buffer too large for that gets no point lights.
+class ClusteredLights {
+public:
+    static const unsigned int GRID_X = 16;
+    static const unsigned int GRID_Y = 9;
+    static const unsigned int GRID_Z = 24;
+    static const unsigned int CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+    // texture units of the buffer textures, above the ones materials use
+    static const unsigned int LIGHTS_UNIT = 8;
+    static const unsigned int RANGES_UNIT = 9;
+    static const unsigned int INDICES_UNIT = 10;
+
+    ClusteredLights(ThreadPool &pool, StreamBuffer &stream) : pool(pool), stream(stream) {
+        glGenBuffers(1, &lightsBuffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, lightsBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STATIC_DRAW);
+        lightsTexture = createBufferTexture(lightsBuffer, GL_RGBA32F);
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+        GLint alignment = 256;
+        if (glExtensions().textureBufferRange)
+            glGetIntegerv(GL_TEXTURE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        listAlignment = std::max(alignment, 16);
+        glGenTextures(1, &rangesTexture);
+        glGenTextures(1, &indicesTexture);
+        if (!glExtensions().textureBufferRange) {
+            wholeBufferFits = stream.size() / (GLsizeiptr) sizeof(unsigned int) <= maxTexels;
+            if (wholeBufferFits) {
+                attachBuffer(rangesTexture, GL_RG32UI, stream.ID);
+                attachBuffer(indicesTexture, GL_R32UI, stream.ID);
+            } else {
+                std::cout << "ERROR::CLUSTERED_LIGHTS::STREAM_BUFFER_OVER_TEXTURE_BUFFER_SIZE: " << stream.size()
+                          << " bytes, " << maxTexels << " texels" << std::endl;
+            }
+        }
+        setPointLights({});
+    }
+
+    ~ClusteredLights() {
+        unsigned int textures[] = {lightsTexture, rangesTexture, indicesTexture};
+        glDeleteTextures(3, textures);
+        glDeleteBuffers(1, &lightsBuffer);
+    }
+
+    ClusteredLights(const ClusteredLights &) = delete;
+    ClusteredLights &operator=(const ClusteredLights &) = delete;
+
+    // points the shader's clusterLights, clusterRanges and clusterLightIndices samplers at their units,
+    // the Clusters block is bound by bindSceneUniformBlocks
+    static void setupShader(Shader &shader) {
+        shader.use();
+        shader.setInt("clusterLights", LIGHTS_UNIT);
+        shader.setInt("clusterRanges", RANGES_UNIT);
+        shader.setInt("clusterLightIndices", INDICES_UNIT);
+    }
+
+    // uploads the point lights, call whenever they change; lights that are off are dropped
+    void setPointLights(const std::vector<PointLight> &pointLights) {
+        lights.clear();
+        radii.clear();
+        for (const PointLight &light : pointLights) {
+            float radius = pointLightRadius(light);
+            if (radius <= 0.0f)
+                continue;
+            lights.push_back(light);
+            radii.push_back(radius);
+        }
+        // a buffer texture needs a data store even without lights
+        PointLight none = PointLight();
+        glBindBuffer(GL_TEXTURE_BUFFER, lightsBuffer);
+        if (lights.empty())
+            glBufferData(GL_TEXTURE_BUFFER, sizeof(PointLight), &none, GL_STATIC_DRAW);
+        else
+            glBufferData(GL_TEXTURE_BUFFER, lights.size() * sizeof(PointLight), lights.data(), GL_STATIC_DRAW);
+        renderStats().bufferUpload(lights.size() * sizeof(PointLight));
+    }
+
+    // assigns the lights to the clusters of this frame's view and writes the lists and the Clusters
+    // block into the stream buffer, between its beginFrame() and flush(); near and far must be the
+    // planes of the projection and width x height the viewport
+    void update(const glm::mat4 &view, const glm::mat4 &projection, float near, float far, int width, int height) {
+        PROFILE_SCOPE("light clustering");
+        if (projection != clusterProjection || near != clusterNear || far != clusterFar)
+            buildClusterBounds(projection, near, far);
+
+        viewLights.resize(lights.size());
+        for (unsigned int i = 0; i < lights.size(); i++)
+            viewLights[i] = glm::vec4(glm::vec3(view * glm::vec4(lights[i].position, 1.0f)), radii[i]);
+
+        pool.parallelFor(GRID_Z, [this](unsigned int slice) { assignSlice(slice); });
+
+        // the slices wrote their lists separately, they go one after the other behind the ranges
+        unsigned int indexCount = 0;
+        for (const std::vector<unsigned int> &list : sliceIndices)
+            indexCount += list.size();
+        bool ranged = glExtensions().textureBufferRange;
+        StreamBuffer::Allocation rangesAllocation, indicesAllocation;
+        if ((ranged || wholeBufferFits) && indexCount <= (unsigned int) maxTexels) {
+            rangesAllocation = stream.allocate(ranges.size() * sizeof(glm::uvec2), listAlignment);
+            indicesAllocation = stream.allocate(glm::max(indexCount, 1u) * sizeof(unsigned int), listAlignment);
+        }
+        ClusterUniforms clusterUniforms;
+        // no grid tells the shaders there are no point lights, when the lists had no room in the stream
+        // buffer or more entries than a buffer texture holds
+        clusterUniforms.grid = glm::uvec4(0);
+        if (rangesAllocation.data && indicesAllocation.data) {
+            // texels count from where the textures start, the lists themselves or the whole buffer
+            GLintptr rangesStart = ranged ? rangesAllocation.offset : 0;
+            GLintptr indicesStart = ranged ? indicesAllocation.offset : 0;
+            unsigned int *indices = (unsigned int *) indicesAllocation.data;
+            unsigned int offset = (indicesAllocation.offset - indicesStart) / sizeof(unsigned int);
+            for (unsigned int slice = 0; slice < GRID_Z; slice++) {
+                for (unsigned int cluster = slice * GRID_X * GRID_Y; cluster < (slice + 1) * GRID_X * GRID_Y; cluster++)
+                    ranges[cluster].x += offset;
+                std::memcpy(indices, sliceIndices[slice].data(), sliceIndices[slice].size() * sizeof(unsigned int));
+                indices += sliceIndices[slice].size();
+                offset += sliceIndices[slice].size();
+            }
+            std::memcpy(rangesAllocation.data, ranges.data(), ranges.size() * sizeof(glm::uvec2));
+            if (ranged) {
+                attachRange(rangesTexture, GL_RG32UI, rangesAllocation);
+                attachRange(indicesTexture, GL_R32UI, indicesAllocation);
+            }
+            clusterUniforms.grid = glm::uvec4(GRID_X, GRID_Y, GRID_Z, (rangesAllocation.offset - rangesStart) / sizeof(glm::uvec2));
+        }
+        float slicesPerLog = GRID_Z / std::log(far / near);
+        clusterUniforms.scale = glm::vec4((float) GRID_X / width, (float) GRID_Y / height,
+                                          slicesPerLog, slicesPerLog * std::log(near));
+        stream.bindUniformRange(CLUSTER_UNIFORMS_BINDING, stream.writeUniforms(clusterUniforms));
+    }
+
+    // binds the buffer textures on their units
+    void bind() const {
+        glState().bindTexture(LIGHTS_UNIT, GL_TEXTURE_BUFFER, lightsTexture);
+        glState().bindTexture(RANGES_UNIT, GL_TEXTURE_BUFFER, rangesTexture);
+        glState().bindTexture(INDICES_UNIT, GL_TEXTURE_BUFFER, indicesTexture);
+    }
+
+    unsigned int lightCount() const {
+        return lights.size();
+    }
+
+    // light references over all clusters of the last update
+    unsigned int assignedCount() const {
+        unsigned int count = 0;
+        for (const std::vector<unsigned int> &slice : sliceIndices)
+            count += slice.size();
+        return count;
+    }
+
+private:
+    struct Bounds {
+        glm::vec3 min, max;
+    };
+
+    ThreadPool &pool;
+    StreamBuffer &stream;
+    unsigned int lightsBuffer = 0;
+    unsigned int lightsTexture = 0, rangesTexture = 0, indicesTexture = 0;
+    // texels a buffer texture may have, and where the lists may start for glTexBufferRange
+    GLint maxTexels = 65536;
+    GLsizeiptr listAlignment = 16;
+    // without glTexBufferRange, whether the textures can view the whole stream buffer
+    bool wholeBufferFits = false;
+
+    std::vector<PointLight> lights;
+    std::vector<float> radii;
+    // view space position and radius of every light
+    std::vector<glm::vec4> viewLights;
+
+    glm::mat4 clusterProjection = glm::mat4(0.0f);
+    float clusterNear = 0.0f, clusterFar = 0.0f;
+    // view space bounding box of every cluster, x fastest, then y, then the slice
+    std::vector<Bounds> clusterBounds = std::vector<Bounds>(CLUSTER_COUNT);
+    // view space depth range of every slice
+    float sliceDepths[GRID_Z + 1];
+
+    std::vector<glm::uvec2> ranges = std::vector<glm::uvec2>(CLUSTER_COUNT);
+    std::vector<std::vector<unsigned int>> sliceIndices = std::vector<std::vector<unsigned int>>(GRID_Z);
+
+    // the buffer must already have a data store
+    static unsigned int createBufferTexture(unsigned int buffer, GLenum format) {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        attachBuffer(texture, format, buffer);
+        return texture;
+    }
+
+    static void attachBuffer(unsigned int texture, GLenum format, unsigned int buffer) {
+        glState().bindTexture(0, GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+    }
+
+    void attachRange(unsigned int texture, GLenum format, const StreamBuffer::Allocation &allocation) {
+        glState().bindTexture(0, GL_TEXTURE_BUFFER, texture);
+        glExtensions().TexBufferRange(GL_TEXTURE_BUFFER, format, stream.ID, allocation.offset, allocation.size);
+    }
+
+    // boxes around the frustum pieces of every cluster, they only change with the projection
+    void buildClusterBounds(const glm::mat4 &projection, float near, float far) {
+        clusterProjection = projection;
+        clusterNear = near;
+        clusterFar = far;
+        for (unsigned int slice = 0; slice <= GRID_Z; slice++)
+            sliceDepths[slice] = near * std::pow(far / near, (float) slice / GRID_Z);
+
+        for (unsigned int z = 0; z < GRID_Z; z++) {
+            float depths[2] = {sliceDepths[z], sliceDepths[z + 1]};
+            for (unsigned int y = 0; y < GRID_Y; y++) {
+                float ndcY[2] = {-1.0f + 2.0f * y / GRID_Y, -1.0f + 2.0f * (y + 1) / GRID_Y};
+                for (unsigned int x = 0; x < GRID_X; x++) {
+                    float ndcX[2] = {-1.0f + 2.0f * x / GRID_X, -1.0f + 2.0f * (x + 1) / GRID_X};
+                    Bounds bounds = {glm::vec3(INFINITY), glm::vec3(-INFINITY)};
+                    // a symmetric perspective projection maps view (x, y) at depth d to ndc * d / scale
+                    for (float depth : depths) {
+                        for (float nx : ndcX) {
+                            for (float ny : ndcY) {
+                                glm::vec3 corner(nx * depth / projection[0][0], ny * depth / projection[1][1], -depth);
+                                bounds.min = glm::min(bounds.min, corner);
+                                bounds.max = glm::max(bounds.max, corner);
+                            }
+                        }
+                    }
+                    clusterBounds[(z * GRID_Y + y) * GRID_X + x] = bounds;
+                }
+            }
+        }
+    }
+
+    // runs on the thread pool, only touches the slice's own clusters and list
+    void assignSlice(unsigned int slice) {
+        PROFILE_SCOPE("assign light slice");
+        // lights whose sphere reaches into the slice's depth range
+        std::vector<unsigned int> candidates;
+        for (unsigned int i = 0; i < viewLights.size(); i++) {
+            float depth = -viewLights[i].z;
+            if (depth + viewLights[i].w >= sliceDepths[slice] && depth - viewLights[i].w <= sliceDepths[slice + 1])
+                candidates.push_back(i);
+        }
+
+        std::vector<unsigned int> &list = sliceIndices[slice];
+        list.clear();
+        for (unsigned int cluster = slice * GRID_X * GRID_Y; cluster < (slice + 1) * GRID_X * GRID_Y; cluster++) {
+            const Bounds &bounds = clusterBounds[cluster];
+            ranges[cluster] = glm::uvec2(list.size(), 0);
+            for (unsigned int i : candidates) {
+                glm::vec3 center(viewLights[i]);
+                glm::vec3 closest = glm::clamp(center, bounds.min, bounds.max);
+                glm::vec3 offset = center - closest;
+                if (glm::dot(offset, offset) <= viewLights[i].w * viewLights[i].w)
+                    list.push_back(i);
+            }
+            ranges[cluster].y = list.size() - ranges[cluster].x;
+        }
+    }
+};
+
+#endif //PROJECT_BASE_CLUSTEREDLIGHTS_H
@@ -0,0 +1,203 @@
+#ifndef PROJECT_BASE_CPUPROFILER_H
+#define PROJECT_BASE_CPUPROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Timeline of what every thread did on the CPU, written as a Chrome trace (chrome://tracing,
+// ui.perfetto.dev). PROFILE_SCOPE marks a block; nothing is recorded until capture() is asked
+// for a number of frames, so outside a capture a scope costs one relaxed load.
+// Every thread writes into a buffer of its own that only it ever writes: an event goes into the
+// slot after the last one and the count is published afterwards, so recording takes no lock and
+// the exporter reads every event counted. The buffers are rings that are never cleared, a capture
+// remembers where each of them stood when it began; a thread that records more than
+// CAPACITY - STRAGGLERS events in a capture loses the oldest ones.
+class CpuProfiler {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static const unsigned int CAPACITY = 1 << 15;
+    // scopes still open when a capture stops record after it, into the slots after the last one
+    // read; the trace leaves that many free so they never overwrite an event being written out
+    static const unsigned int STRAGGLERS = 256;
+
+    CpuProfiler() : epoch(Clock::now()) {}
+
+    CpuProfiler(const CpuProfiler &) = delete;
+    CpuProfiler &operator=(const CpuProfiler &) = delete;
+
+    // nanoseconds since the profiler was created
+    std::uint64_t now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch).count();
+    }
+
+    bool capturing() const {
+        return active.load(std::memory_order_relaxed);
+    }
+
+    // name must outlive the profiler; called from the thread the event happened on
+    void record(const char *name, std::uint64_t begin, std::uint64_t end) {
+        ThreadBuffer &buffer = threadBuffer();
+        if (buffer.events.empty())
+            buffer.events.resize(CAPACITY);
+        std::uint64_t index = buffer.written.load(std::memory_order_relaxed);
+        buffer.events[index % CAPACITY] = Event{name, begin, end};
+        buffer.written.store(index + 1, std::memory_order_release);
+    }
+
+    // the name the calling thread gets in the trace
+    void nameThread(const std::string &name) {
+        ThreadBuffer &buffer = threadBuffer();
+        std::lock_guard<std::mutex> lock(mutex);
+        buffer.name = name;
+    }
+
+    // records until frameBoundary() was called frames more times, then writes the trace to path.
+    // Ignored while a capture is running
+    void capture(unsigned int frames, const std::string &path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (active.load())
+            return;
+        for (std::unique_ptr<ThreadBuffer> &buffer : buffers)
+            buffer->captureStart = buffer->written.load(std::memory_order_acquire);
+        framesLeft = frames;
+        tracePath = path;
+        active.store(true);
+    }
+
+    // call at the top of every iteration of the render loop
+    void frameBoundary() {
+        if (!capturing())
+            return;
+        if (framesLeft > 0) {
+            framesLeft--;
+            return;
+        }
+        active.store(false);
+        write();
+    }
+
+private:
+    struct Event {
+        const char *name;
+        std::uint64_t begin, end;
+    };
+
+    struct ThreadBuffer {
+        unsigned int id;
+        std::string name;
+        // allocated by the owning thread with its first event, published by written
+        std::vector<Event> events;
+        std::atomic<std::uint64_t> written{0};
+        std::uint64_t captureStart = 0;
+    };
+
+    Clock::time_point epoch;
+    std::atomic<bool> active{false};
+    unsigned int framesLeft = 0;
+    std::string tracePath;
+    // guards buffers, the thread names and starting a capture
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+    // the buffer of the calling thread, registered the first time it asks
+    ThreadBuffer &threadBuffer() {
+        static thread_local ThreadBuffer *buffer = nullptr;
+        if (!buffer) {
+            std::lock_guard<std::mutex> lock(mutex);
+            buffers.emplace_back(new ThreadBuffer());
+            buffer = buffers.back().get();
+            buffer->id = buffers.size();
+            buffer->name = "thread " + std::to_string(buffer->id);
+        }
+        return *buffer;
+    }
+
+    // events of a capture with timestamps in microseconds, one "X" (complete) event per scope
+    void write() {
+        std::ofstream file(tracePath);
+        if (!file) {
+            std::cout << "ERROR::CPU_PROFILER::CANNOT_OPEN_TRACE: " << tracePath << std::endl;
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        std::uint64_t events = 0, lost = 0;
+        file << std::fixed << std::setprecision(3);
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        for (std::unique_ptr<ThreadBuffer> &buffer : buffers) {
+            file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+                 << ",\"args\":{\"name\":\"" << escaped(buffer->name) << "\"}}";
+            first = false;
+            std::uint64_t end = buffer->written.load(std::memory_order_acquire);
+            std::uint64_t begin = buffer->captureStart;
+            if (end - begin > CAPACITY - STRAGGLERS) {
+                lost += end - begin - (CAPACITY - STRAGGLERS);
+                begin = end - (CAPACITY - STRAGGLERS);
+            }
+            for (std::uint64_t i = begin; i < end; i++) {
+                const Event &event = buffer->events[i % CAPACITY];
+                file << ",\n{\"name\":\"" << escaped(event.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id
+                     << ",\"ts\":" << event.begin / 1000.0 << ",\"dur\":" << (event.end - event.begin) / 1000.0 << "}";
+            }
+            events += end - begin;
+        }
+        file << "\n]}\n";
+        std::cout << "cpu profiler: " << events << " events written to " << tracePath;
+        if (lost > 0)
+            std::cout << ", " << lost << " lost to full buffers";
+        std::cout << std::endl;
+    }
+
+    static std::string escaped(const std::string &text) {
+        std::string result;
+        for (char c : text) {
+            if (c == '"' || c == '\\')
+                result += '\\';
+            result += c;
+        }
+        return result;
+    }
+};
+
+CpuProfiler &cpuProfiler() {
+    static CpuProfiler profiler;
+    return profiler;
+}
+
+// times the rest of the enclosing block while a capture is running
+class ProfileScope {
+public:
+    explicit ProfileScope(const char *name) : name(name), recording(cpuProfiler().capturing()) {
+        if (recording)
+            begin = cpuProfiler().now();
+    }
+
+    ~ProfileScope() {
+        if (recording)
+            cpuProfiler().record(name, begin, cpuProfiler().now());
+    }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+    const char *name;
+    bool recording;
+    std::uint64_t begin = 0;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// name must be a string literal or otherwise outlive the profiler
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+
+#endif //PROJECT_BASE_CPUPROFILER_H
@@ -0,0 +1,266 @@
+#ifndef PROJECT_BASE_DEFERREDRENDERER_H
+#define PROJECT_BASE_DEFERREDRENDERER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <learnopengl/shader.h>
+#include <rg/GLStateCache.h>
+#include <rg/RenderStats.h>
+#include <rg/UniformBuffers.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+// Deferred shading for the models that use the lighting.fs material.
+// The geometry pass writes albedo + specular intensity and world normals into a G-buffer, positions
+// are rebuilt from its depth. The directional light is one fullscreen pass into the default
+// framebuffer; every point light is an instanced sphere of pointLightRadius(), drawn additively,
+// so a light only costs the pixels it can reach. The depth of the G-buffer is copied into the
+// default framebuffer before the light volumes, which only shade where scene geometry lies inside
+// them, and forward passes after the renderer can depth test against the deferred models.
+// Like SceneTarget the G-buffer has the size of the framebuffer and a frame drawn at a lower
+// render scale only uses its lower-left corner, so a scale change allocates nothing.
+class DeferredRenderer {
+public:
+    DeferredRenderer(Shader &directionalShader, Shader &pointShader)
+            : directionalShader(directionalShader), pointShader(pointShader) {
+        for (Shader *shader : {&directionalShader, &pointShader}) {
+            bindSceneUniformBlocks(*shader);
+            shader->use();
+            shader->setInt("gAlbedoSpecular", 0);
+            shader->setInt("gNormal", 1);
+            shader->setInt("gDepth", 2);
+        }
+        setupSphere();
+        glGenVertexArrays(1, &fullscreenVAO);
+    }
+
+    ~DeferredRenderer() {
+        deleteGBuffer();
+        glDeleteVertexArrays(1, &sphereVAO);
+        glDeleteBuffers(1, &sphereVBO);
+        glDeleteBuffers(1, &sphereEBO);
+        glDeleteBuffers(1, &lightsVBO);
+        glDeleteVertexArrays(1, &fullscreenVAO);
+    }
+
+    DeferredRenderer(const DeferredRenderer &) = delete;
+    DeferredRenderer &operator=(const DeferredRenderer &) = delete;
+
+    // uploads the point lights, call whenever they change
+    void setPointLights(const std::vector<PointLight> &lights) {
+        std::vector<LightInstance> instances;
+        instances.reserve(lights.size());
+        for (const PointLight &light : lights) {
+            float radius = pointLightRadius(light);
+            if (radius <= 0.0f)
+                continue;
+            LightInstance instance;
+            // the sphere mesh is a polyhedron inside the unit sphere, grow it so it covers the whole radius
+            instance.positionRadius = glm::vec4(light.position, radius * sphereScale);
+            instance.attenuation = glm::vec3(light.constant, light.linear, light.quadratic);
+            instance.ambient = light.ambient;
+            instance.diffuse = light.diffuse;
+            instance.specular = light.specular;
+            instances.push_back(instance);
+        }
+        lightCount = instances.size();
+        glBindBuffer(GL_ARRAY_BUFFER, lightsVBO);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(LightInstance), instances.data(), GL_STATIC_DRAW);
+        renderStats().bufferUpload(instances.size() * sizeof(LightInstance));
+    }
+
+    unsigned int pointLightCount() const {
+        return lightCount;
+    }
+
+    // (re)creates the G-buffer when the framebuffer size changed, not when the render scale does
+    void resize(int newWidth, int newHeight) {
+        if (newWidth == width && newHeight == height)
+            return;
+        width = newWidth;
+        height = newHeight;
+        deleteGBuffer();
+
+        glGenFramebuffers(1, &gBuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
+        gAlbedoSpecular = createAttachment(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT0);
+        gNormal = createAttachment(GL_RGB16F, GL_RGB, GL_FLOAT, GL_COLOR_ATTACHMENT1);
+        // same format as the default framebuffer's depth, so it can be blitted there
+        gDepth = createAttachment(GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, GL_DEPTH_STENCIL_ATTACHMENT);
+        GLenum attachments[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+        glDrawBuffers(2, attachments);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::DEFERRED::G_BUFFER_INCOMPLETE" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // binds and clears the G-buffer, draw the deferred models with the G-buffer shaders afterwards
+    void beginGeometryPass() {
+        glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    // lights the renderSize corner of the G-buffer into output, the default framebuffer or one with
+    // the same depth format, which must already be cleared
+    void endGeometryPass(const glm::mat4 &inverseViewProjection, float shininess, const glm::ivec2 &renderSize,
+                         unsigned int output = 0) {
+        glBindFramebuffer(GL_FRAMEBUFFER, output);
+        glState().bindTexture(0, GL_TEXTURE_2D, gAlbedoSpecular);
+        glState().bindTexture(1, GL_TEXTURE_2D, gNormal);
+        glState().bindTexture(2, GL_TEXTURE_2D, gDepth);
+
+        // directional light, everywhere something was drawn
+        glState().setEnabled(GL_DEPTH_TEST, false);
+        glState().depthMask(false);
+        directionalShader.use();
+        directionalShader.setMat4("inverseViewProjection"_uniform, inverseViewProjection);
+        directionalShader.setVec2("renderSize"_uniform, glm::vec2(renderSize));
+        glState().bindVertexArray(fullscreenVAO);
+        renderStats().drawArrays(GL_TRIANGLES, 0, 3);
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, output);
+        glBlitFramebuffer(0, 0, renderSize.x, renderSize.y, 0, 0, renderSize.x, renderSize.y, GL_DEPTH_BUFFER_BIT,
+                          GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, output);
+
+        // point lights: back faces of the volumes that have geometry in front of them, added on top
+        if (lightCount) {
+            glState().setEnabled(GL_DEPTH_TEST, true);
+            glState().depthFunc(GL_GEQUAL);
+            glState().setEnabled(GL_CULL_FACE, true);
+            glState().cullFace(GL_FRONT);
+            glState().setEnabled(GL_BLEND, true);
+            glState().blendFunc(GL_ONE, GL_ONE);
+            pointShader.use();
+            pointShader.setMat4("inverseViewProjection"_uniform, inverseViewProjection);
+            pointShader.setVec2("renderSize"_uniform, glm::vec2(renderSize));
+            pointShader.setFloat("shininess"_uniform, shininess);
+            glState().bindVertexArray(sphereVAO);
+            renderStats().drawElementsInstanced(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, 0, lightCount);
+            glState().setEnabled(GL_BLEND, false);
+            glState().setEnabled(GL_CULL_FACE, false);
+        }
+
+        glState().setEnabled(GL_DEPTH_TEST, true);
+        glState().depthFunc(GL_LESS);
+        glState().depthMask(true);
+    }
+
+private:
+    static const unsigned int SPHERE_RINGS = 8;
+    static const unsigned int SPHERE_SEGMENTS = 12;
+
+    struct LightInstance {
+        glm::vec4 positionRadius;
+        glm::vec3 attenuation;
+        glm::vec3 ambient;
+        glm::vec3 diffuse;
+        glm::vec3 specular;
+    };
+
+    Shader &directionalShader;
+    Shader &pointShader;
+    int width = 0, height = 0;
+    unsigned int gBuffer = 0, gAlbedoSpecular = 0, gNormal = 0, gDepth = 0;
+    unsigned int sphereVAO = 0, sphereVBO = 0, sphereEBO = 0, lightsVBO = 0;
+    unsigned int sphereIndexCount = 0;
+    // what the mesh grows by so its flat faces stay outside the real sphere: 1 over the distance
+    // of the nearest face plane, which depends on both the ring and the segment spacing (1.054 for
+    // 8 x 12), so it is measured on the mesh
+    float sphereScale = 1.0f;
+    unsigned int lightCount = 0;
+    unsigned int fullscreenVAO = 0;
+
+    unsigned int createAttachment(GLint internalFormat, GLenum format, GLenum type, GLenum attachment) {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glState().bindTexture(0, GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+        return texture;
+    }
+
+    void deleteGBuffer() {
+        if (!gBuffer)
+            return;
+        unsigned int textures[] = {gAlbedoSpecular, gNormal, gDepth};
+        glDeleteTextures(3, textures);
+        glDeleteFramebuffers(1, &gBuffer);
+        // deleted names can come back from glGenTextures, the cache must not think they are bound
+        glState().invalidate();
+        gBuffer = 0;
+    }
+
+    // unit UV sphere plus the per light instance attributes
+    void setupSphere() {
+        std::vector<glm::vec3> vertices;
+        for (unsigned int ring = 0; ring <= SPHERE_RINGS; ring++) {
+            float phi = glm::pi<float>() * ring / SPHERE_RINGS;
+            for (unsigned int segment = 0; segment <= SPHERE_SEGMENTS; segment++) {
+                float theta = 2.0f * glm::pi<float>() * segment / SPHERE_SEGMENTS;
+                vertices.push_back(glm::vec3(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta)));
+            }
+        }
+        std::vector<unsigned int> indices;
+        for (unsigned int ring = 0; ring < SPHERE_RINGS; ring++) {
+            for (unsigned int segment = 0; segment < SPHERE_SEGMENTS; segment++) {
+                unsigned int a = ring * (SPHERE_SEGMENTS + 1) + segment;
+                unsigned int b = a + SPHERE_SEGMENTS + 1;
+                // counter-clockwise seen from outside
+                indices.insert(indices.end(), {a, a + 1, b, b, a + 1, b + 1});
+            }
+        }
+        sphereIndexCount = indices.size();
+        float nearestFace = 1.0f;
+        for (unsigned int i = 0; i < indices.size(); i += 3) {
+            glm::vec3 a = vertices[indices[i]], b = vertices[indices[i + 1]], c = vertices[indices[i + 2]];
+            glm::vec3 normal = glm::cross(b - a, c - a);
+            // the triangles at the poles have two corners in one place
+            if (glm::length(normal) > 1e-6f)
+                nearestFace = std::min(nearestFace, std::abs(glm::dot(glm::normalize(normal), a)));
+        }
+        // and a little more for the rasteriser
+        sphereScale = 1.01f / nearestFace;
+
+        glGenVertexArrays(1, &sphereVAO);
+        glGenBuffers(1, &sphereVBO);
+        glGenBuffers(1, &sphereEBO);
+        glGenBuffers(1, &lightsVBO);
+        glState().bindVertexArray(sphereVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+
+        glBindBuffer(GL_ARRAY_BUFFER, lightsVBO);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(LightInstance), (void*)offsetof(LightInstance, positionRadius));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(LightInstance), (void*)offsetof(LightInstance, attenuation));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(LightInstance), (void*)offsetof(LightInstance, ambient));
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(LightInstance), (void*)offsetof(LightInstance, diffuse));
+        glEnableVertexAttribArray(5);
+        glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(LightInstance), (void*)offsetof(LightInstance, specular));
+        for (unsigned int attribute = 1; attribute <= 5; attribute++)
+            glVertexAttribDivisor(attribute, 1);
+        glState().bindVertexArray(0);
+    }
+};
+
+#endif //PROJECT_BASE_DEFERREDRENDERER_H
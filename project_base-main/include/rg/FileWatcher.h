@@ -0,0 +1,90 @@
+#ifndef PROJECT_BASE_FILEWATCHER_H
+#define PROJECT_BASE_FILEWATCHER_H
+
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// Reports files written in a set of directories, through inotify on Linux and not at all elsewhere.
+// The descriptor is non-blocking, so poll() can be called every frame and only costs a read() that
+// returns nothing. A file counts as changed when a writer closes it or when it is renamed into the
+// directory, which is how most editors save, so a half written file is never reported.
+class FileWatcher {
+public:
+    FileWatcher() {
+#ifdef __linux__
+        descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (descriptor < 0)
+            std::cout << "ERROR::FILE_WATCHER::INOTIFY_NOT_AVAILABLE" << std::endl;
+#endif
+    }
+
+    ~FileWatcher() {
+#ifdef __linux__
+        if (descriptor >= 0)
+            close(descriptor);
+#endif
+    }
+
+    FileWatcher(const FileWatcher &) = delete;
+    FileWatcher &operator=(const FileWatcher &) = delete;
+
+    bool available() const {
+        return descriptor >= 0;
+    }
+
+    // watches the files directly inside directory, watching one twice does nothing
+    void watch(const std::string &directory) {
+#ifdef __linux__
+        if (descriptor < 0)
+            return;
+        int watch = inotify_add_watch(descriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR);
+        if (watch < 0) {
+            std::cout << "ERROR::FILE_WATCHER::CANNOT_WATCH: " << directory << std::endl;
+            return;
+        }
+        // the same directory gets the same watch back, keep the name it was first added with
+        directories.insert(std::make_pair(watch, directory));
+#endif
+    }
+
+    unsigned int directoryCount() const {
+        return directories.size();
+    }
+
+    // "directory/name" of every file changed since the last call, each one reported once
+    std::vector<std::string> poll() {
+        std::set<std::string> changed;
+#ifdef __linux__
+        if (descriptor < 0)
+            return std::vector<std::string>();
+        alignas(inotify_event) char buffer[4096];
+        ssize_t length;
+        while ((length = read(descriptor, buffer, sizeof(buffer))) > 0) {
+            for (char *position = buffer; position < buffer + length;) {
+                const inotify_event *event = (const inotify_event *) position;
+                position += sizeof(inotify_event) + event->len;
+                auto directory = directories.find(event->wd);
+                if (event->len == 0 || directory == directories.end())
+                    continue;
+                changed.insert(directory->second + "/" + event->name);
+            }
+        }
+#endif
+        return std::vector<std::string>(changed.begin(), changed.end());
+    }
+
+private:
+    int descriptor = -1;
+    // watch descriptor -> directory
+    std::map<int, std::string> directories;
+};
+
+#endif //PROJECT_BASE_FILEWATCHER_H
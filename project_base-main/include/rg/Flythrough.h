@@ -0,0 +1,164 @@
+#ifndef PROJECT_BASE_FLYTHROUGH_H
+#define PROJECT_BASE_FLYTHROUGH_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Camera path through timed keys of position and view direction, with the times day and night
+// switch, for replaying the same frames run after run. Between keys the position and direction
+// follow a cubic Hermite spline whose tangents are the finite differences over the neighbouring
+// keys, so the camera passes through every key without stopping at it.
+// The file has one entry per line, times in seconds, # starts a comment:
+//     key <time> <position x y z> <direction x y z>
+//     light <time> day|night
+class Flythrough {
+public:
+    struct Key {
+        float time;
+        glm::vec3 position;
+        glm::vec3 front;
+    };
+
+    struct LightChange {
+        float time;
+        bool day;
+    };
+
+    bool load(const std::string &path) {
+        std::ifstream file(path);
+        if (!file) {
+            std::cout << "ERROR::FLYTHROUGH::CANNOT_OPEN: " << path << std::endl;
+            return false;
+        }
+        keys.clear();
+        lightChanges.clear();
+        std::string line;
+        for (unsigned int number = 1; std::getline(file, line); number++) {
+            std::istringstream in(line.substr(0, line.find('#')));
+            std::string kind;
+            if (!(in >> kind))
+                continue;
+            Key key;
+            LightChange change;
+            std::string light;
+            if (kind == "key" && in >> key.time >> key.position.x >> key.position.y >> key.position.z >> key.front.x
+                                    >> key.front.y >> key.front.z && glm::length(key.front) > 0.0f) {
+                addKey(key.time, key.position, key.front);
+            } else if (kind == "light" && in >> change.time >> light && (light == "day" || light == "night")) {
+                addLightChange(change.time, light == "day");
+            } else {
+                std::cout << "ERROR::FLYTHROUGH::BAD_LINE: " << path << ":" << number << std::endl;
+                return false;
+            }
+        }
+        if (keys.size() < 2) {
+            std::cout << "ERROR::FLYTHROUGH::NEEDS_TWO_KEYS: " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool save(const std::string &path) const {
+        std::ofstream file(path);
+        if (!file) {
+            std::cout << "ERROR::FLYTHROUGH::CANNOT_WRITE: " << path << std::endl;
+            return false;
+        }
+        file << "# key <time> <position x y z> <direction x y z>\n";
+        for (const Key &key : keys)
+            file << "key " << key.time << ' ' << key.position.x << ' ' << key.position.y << ' ' << key.position.z
+                 << ' ' << key.front.x << ' ' << key.front.y << ' ' << key.front.z << '\n';
+        file << "# light <time> day|night\n";
+        for (const LightChange &change : lightChanges)
+            file << "light " << change.time << ' ' << (change.day ? "day" : "night") << '\n';
+        return true;
+    }
+
+    // keys and changes may come in any order
+    void addKey(float time, const glm::vec3 &position, const glm::vec3 &front) {
+        Key key{time, position, glm::normalize(front)};
+        keys.insert(std::upper_bound(keys.begin(), keys.end(), key, [](const Key &a, const Key &b) {
+            return a.time < b.time;
+        }), key);
+    }
+
+    void addLightChange(float time, bool day) {
+        LightChange change{time, day};
+        lightChanges.insert(std::upper_bound(lightChanges.begin(), lightChanges.end(), change,
+                                             [](const LightChange &a, const LightChange &b) {
+                                                 return a.time < b.time;
+                                             }), change);
+    }
+
+    unsigned int keyCount() const {
+        return keys.size();
+    }
+
+    // times of the first and the last key
+    float startTime() const {
+        return keys.empty() ? 0.0f : keys.front().time;
+    }
+
+    float endTime() const {
+        return keys.empty() ? 0.0f : keys.back().time;
+    }
+
+    // camera at time, clamped to the path; up is square to front and as close to +y as it gets
+    void pose(float time, glm::vec3 &position, glm::vec3 &front, glm::vec3 &up) const {
+        if (keys.empty())
+            return;
+        time = std::min(std::max(time, startTime()), endTime());
+        unsigned int i = 0;
+        while (i + 2 < keys.size() && keys[i + 1].time <= time)
+            i++;
+        const Key &a = keys[i];
+        const Key &b = keys[std::min(i + 1, (unsigned int) keys.size() - 1)];
+        float span = b.time - a.time;
+        float t = span > 0.0f ? (time - a.time) / span : 0.0f;
+
+        position = hermite(a.position, b.position, tangent(i, &Key::position) * span,
+                           tangent(i + 1, &Key::position) * span, t);
+        front = glm::normalize(hermite(a.front, b.front, tangent(i, &Key::front) * span,
+                                       tangent(i + 1, &Key::front) * span, t));
+        glm::vec3 right = glm::normalize(glm::cross(front, glm::vec3(0.0f, 1.0f, 0.0f)));
+        up = glm::normalize(glm::cross(right, front));
+    }
+
+    // whether it is day at time; before the first change it is whatever before is
+    bool dayAt(float time, bool before) const {
+        bool day = before;
+        for (const LightChange &change : lightChanges) {
+            if (change.time > time)
+                break;
+            day = change.day;
+        }
+        return day;
+    }
+
+private:
+    std::vector<Key> keys;
+    std::vector<LightChange> lightChanges;
+
+    // per second, zero at the ends so the camera eases in and out of the path
+    glm::vec3 tangent(unsigned int i, glm::vec3 Key::*value) const {
+        if (i == 0 || i + 1 >= keys.size())
+            return glm::vec3(0.0f);
+        float span = keys[i + 1].time - keys[i - 1].time;
+        return span > 0.0f ? (keys[i + 1].*value - keys[i - 1].*value) / span : glm::vec3(0.0f);
+    }
+
+    static glm::vec3 hermite(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &m0, const glm::vec3 &m1,
+                             float t) {
+        float t2 = t * t, t3 = t2 * t;
+        return (2.0f * t3 - 3.0f * t2 + 1.0f) * p0 + (t3 - 2.0f * t2 + t) * m0 + (-2.0f * t3 + 3.0f * t2) * p1 +
+               (t3 - t2) * m1;
+    }
+};
+
+#endif //PROJECT_BASE_FLYTHROUGH_H
@@ -0,0 +1,186 @@
+#ifndef PROJECT_BASE_FRAMEPACER_H
+#define PROJECT_BASE_FRAMEPACER_H
+
+#include <GLFW/glfw3.h>
+
+#include <rg/CpuProfiler.h>
+#include <rg/FrameTimes.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Decides when the render loop draws and presents. VSYNC leaves the pace to the swap interval,
+// LIMITED presents at most targetFps frames a second without vsync, sleeping for most of the wait
+// and spinning the rest because a sleep can wake up late, and ON_DEMAND skips frames nothing
+// changed, waiting for events instead. Whatever marks the frame dirty (input, the simulation,
+// reloaded files) gets SETTLE_FRAMES more frames drawn, for the results read back a few frames
+// late (occlusion queries, GPU timers) to catch up.
+// Every present is timed; the last HISTORY intervals give the jitter and can be logged to a file.
+class FramePacer {
+public:
+    enum Mode {
+        VSYNC,
+        LIMITED,
+        ON_DEMAND,
+        MODE_COUNT
+    };
+
+    typedef std::chrono::steady_clock Clock;
+
+    static const unsigned int SETTLE_FRAMES = 3;
+    static const unsigned int HISTORY = 240;
+    // the part of a LIMITED wait that is spun instead of slept
+    static constexpr double SPIN_SECONDS = 0.002;
+
+    static const char *modeName(Mode mode) {
+        switch (mode) {
+            case VSYNC: return "vsync";
+            case LIMITED: return "frame limit";
+            case ON_DEMAND: return "render on demand";
+            default: return "?";
+        }
+    }
+
+    // sets the swap interval, so the window's context must be current
+    void setMode(Mode mode) {
+        currentMode = mode;
+        glfwSwapInterval(mode == LIMITED ? 0 : 1);
+        deadline = Clock::now();
+        markDirty();
+    }
+
+    Mode mode() const {
+        return currentMode;
+    }
+
+    void setTargetFps(double fps) {
+        targetFps = std::max(fps, 1.0);
+    }
+
+    void markDirty() {
+        dirtyFrames = SETTLE_FRAMES;
+    }
+
+    // whether to draw this iteration of the loop, always true but in ON_DEMAND
+    bool shouldRender() {
+        if (currentMode != ON_DEMAND)
+            return true;
+        if (dirtyFrames == 0)
+            return false;
+        dirtyFrames--;
+        return true;
+    }
+
+    // for an iteration that draws nothing: blocks until an event comes in or timeout seconds pass
+    void idle(double timeout) {
+        PROFILE_SCOPE("wait events");
+        glfwWaitEventsTimeout(timeout);
+    }
+
+    // call right before glfwSwapBuffers, LIMITED waits here until the frame is due
+    void waitForPresent() {
+        if (currentMode != LIMITED)
+            return;
+        PROFILE_SCOPE("frame limit wait");
+        Clock::duration frame = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFps));
+        Clock::duration spin = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(SPIN_SECONDS));
+        Clock::time_point now = Clock::now();
+        // a frame that took longer than a whole interval starts the schedule over instead of
+        // rushing the next ones to catch up
+        deadline = std::max(deadline + frame, now - frame);
+        if (deadline - now > spin)
+            std::this_thread::sleep_for(deadline - now - spin);
+        while (Clock::now() < deadline)
+            std::this_thread::yield();
+    }
+
+    // call right after glfwSwapBuffers
+    void presented() {
+        Clock::time_point now = Clock::now();
+        if (presents > 0) {
+            float interval = std::chrono::duration<float, std::milli>(now - lastPresent).count();
+            if (intervals.size() < HISTORY) {
+                intervals.push_back(interval);
+            } else {
+                intervals[nextInterval] = interval;
+                nextInterval = (nextInterval + 1) % HISTORY;
+            }
+            if (intervalRecord)
+                intervalRecord->add(interval);
+            if (log)
+                log << presents << ',' << std::chrono::duration<double>(now - firstPresent).count() << ','
+                    << interval << ',' << modeName(currentMode) << '\n';
+        } else {
+            firstPresent = now;
+        }
+        lastPresent = now;
+        presents++;
+    }
+
+    // writes frame, seconds since the first present, milliseconds since the previous one and mode per present
+    bool logPresents(const std::string &path) {
+        log.open(path);
+        if (!log) {
+            std::cout << "ERROR::FRAME_PACER::CANNOT_OPEN_LOG: " << path << std::endl;
+            return false;
+        }
+        log << "frame,seconds,interval_ms,mode\n";
+        return true;
+    }
+
+    // every interval from now on also goes into times, null stops it
+    void recordIntervals(FrameTimes *times) {
+        intervalRecord = times;
+    }
+
+    // milliseconds between the last HISTORY presents, oldest first
+    std::vector<float> intervalHistory() const {
+        std::vector<float> history(intervals.begin() + nextInterval, intervals.end());
+        history.insert(history.end(), intervals.begin(), intervals.begin() + nextInterval);
+        return history;
+    }
+
+    void printStats() const {
+        std::cout << "frame pacing: " << modeName(currentMode);
+        if (currentMode == LIMITED)
+            std::cout << " at " << targetFps << " fps";
+        if (intervals.empty()) {
+            std::cout << std::endl;
+            return;
+        }
+        float sum = 0.0f, squares = 0.0f;
+        float shortest = intervals[0], longest = intervals[0];
+        for (float interval : intervals) {
+            sum += interval;
+            squares += interval * interval;
+            shortest = std::min(shortest, interval);
+            longest = std::max(longest, interval);
+        }
+        float mean = sum / intervals.size();
+        float jitter = std::sqrt(std::max(squares / intervals.size() - mean * mean, 0.0f));
+        std::cout << ", last " << intervals.size() << " presents " << mean << " ms apart (" << shortest << " to "
+                  << longest << " ms, jitter " << jitter << " ms)" << std::endl;
+    }
+
+private:
+    Mode currentMode = VSYNC;
+    double targetFps = 60.0;
+    unsigned int dirtyFrames = SETTLE_FRAMES;
+    Clock::time_point deadline;
+    Clock::time_point firstPresent, lastPresent;
+    unsigned long long presents = 0;
+    std::vector<float> intervals;
+    unsigned int nextInterval = 0;
+    std::ofstream log;
+    FrameTimes *intervalRecord = nullptr;
+};
+
+constexpr double FramePacer::SPIN_SECONDS;
+
+#endif //PROJECT_BASE_FRAMEPACER_H
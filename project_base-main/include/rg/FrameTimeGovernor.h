@@ -0,0 +1,124 @@
+#ifndef PROJECT_BASE_FRAMETIMEGOVERNOR_H
+#define PROJECT_BASE_FRAMETIMEGOVERNOR_H
+
+#include <rg/GpuTimer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// Keeps the GPU time of a frame under a target by trading quality for time. The first knob is
+// the render scale, the fraction of the window's width and height the scene is drawn at; once
+// the scale is at MIN_SCALE and frames are still too slow, the level goes up one step at a time
+// and the renderer drops whatever the level stands for. With time to spare, the level comes back
+// down first and the scale goes up after it, one SCALE_STEP at a time.
+// The GPU times arrive a few frames late and a change shows in them later still, so each decision
+// averages WINDOW results measured after the previous change took effect.
+class FrameTimeGovernor {
+public:
+    static constexpr float MIN_SCALE = 0.5f;
+    static constexpr float SCALE_STEP = 0.05f;
+    static const unsigned int MAX_LEVEL = 2;
+    static const unsigned int WINDOW = 8;
+    // over this fraction of the target the frame is too slow, under the second there is room for more
+    static constexpr float SLOW = 0.95f;
+    static constexpr float FAST = 0.75f;
+
+    explicit FrameTimeGovernor(float targetMilliseconds = 16.0f) : target(targetMilliseconds) {
+    }
+
+    void setTarget(float milliseconds) {
+        target = std::max(milliseconds, 1.0f);
+    }
+
+    float targetMilliseconds() const {
+        return target;
+    }
+
+    // takes the newest result of timer, if it has one since the last call
+    void update(const GpuTimer &timer) {
+        if (timer.resultCount() == seenResults)
+            return;
+        seenResults = timer.resultCount();
+        if (skip > 0) {
+            skip--;
+            return;
+        }
+        sum += timer.lastMilliseconds();
+        if (++count < WINDOW)
+            return;
+        lastAverage = sum / count;
+        sum = 0.0;
+        count = 0;
+        decide(lastAverage);
+    }
+
+    // back to full quality, e.g. when dynamic resolution is switched off
+    void reset() {
+        currentScale = 1.0f;
+        currentLevel = 0;
+        sum = 0.0;
+        count = 0;
+        skip = GpuTimer::QUERY_RING_SIZE;
+    }
+
+    float scale() const {
+        return currentScale;
+    }
+
+    unsigned int level() const {
+        return currentLevel;
+    }
+
+    void printStats() const {
+        std::cout << "frame time governor: " << lastAverage << " ms GPU of " << target << " ms, scale "
+                  << currentScale << ", level " << currentLevel << std::endl;
+    }
+
+private:
+    float target;
+    float currentScale = 1.0f;
+    unsigned int currentLevel = 0;
+    unsigned long long seenResults = 0;
+    unsigned int skip = 0;
+    unsigned int count = 0;
+    double sum = 0.0;
+    double lastAverage = 0.0;
+
+    void decide(double milliseconds) {
+        float scale = currentScale;
+        unsigned int level = currentLevel;
+        if (milliseconds > target * SLOW) {
+            if (currentScale > MIN_SCALE) {
+                // the cost goes with the pixel count, the square of the scale
+                float wanted = currentScale * std::sqrt(target * SLOW / milliseconds);
+                scale = std::max(quantize(std::min(wanted, currentScale - SCALE_STEP)), MIN_SCALE);
+            } else if (currentLevel < MAX_LEVEL) {
+                level++;
+            }
+        } else if (milliseconds < target * FAST) {
+            if (currentLevel > 0)
+                level--;
+            else if (currentScale < 1.0f)
+                scale = std::min(quantize(currentScale + SCALE_STEP), 1.0f);
+        }
+        if (scale == currentScale && level == currentLevel)
+            return;
+        currentScale = scale;
+        currentLevel = level;
+        // the frames already in flight were drawn with the old settings
+        skip = GpuTimer::QUERY_RING_SIZE;
+    }
+
+    static float quantize(float scale) {
+        return std::round(scale / SCALE_STEP) * SCALE_STEP;
+    }
+};
+
+// std::max and std::min take the constants by reference, which needs a definition before C++17
+constexpr float FrameTimeGovernor::MIN_SCALE;
+constexpr float FrameTimeGovernor::SCALE_STEP;
+constexpr float FrameTimeGovernor::SLOW;
+constexpr float FrameTimeGovernor::FAST;
+
+#endif //PROJECT_BASE_FRAMETIMEGOVERNOR_H
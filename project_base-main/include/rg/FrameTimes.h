@@ -0,0 +1,67 @@
+#ifndef PROJECT_BASE_FRAMETIMES_H
+#define PROJECT_BASE_FRAMETIMES_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Every frame time of a run in milliseconds, summed up at the end with the percentiles that show
+// hitches an average hides.
+class FrameTimes {
+public:
+    struct Summary {
+        unsigned int count = 0;
+        float average = 0.0f;
+        float p50 = 0.0f, p95 = 0.0f, p99 = 0.0f;
+        float max = 0.0f;
+    };
+
+    void add(float milliseconds) {
+        times.push_back(milliseconds);
+    }
+
+    void clear() {
+        times.clear();
+    }
+
+    unsigned int count() const {
+        return times.size();
+    }
+
+    Summary summary() const {
+        Summary summary;
+        if (times.empty())
+            return summary;
+        std::vector<float> sorted = times;
+        std::sort(sorted.begin(), sorted.end());
+        float sum = 0.0f;
+        for (float time : sorted)
+            sum += time;
+        summary.count = sorted.size();
+        summary.average = sum / sorted.size();
+        summary.p50 = percentile(sorted, 0.50f);
+        summary.p95 = percentile(sorted, 0.95f);
+        summary.p99 = percentile(sorted, 0.99f);
+        summary.max = sorted.back();
+        return summary;
+    }
+
+    void print(const char *label) const {
+        Summary s = summary();
+        std::printf("%s: %u frames, avg %.3f ms, p50 %.3f, p95 %.3f, p99 %.3f, max %.3f\n", label, s.count, s.average,
+                    s.p50, s.p95, s.p99, s.max);
+    }
+
+    // nearest rank of sorted, which must not be empty: the smallest value at least p of the values
+    // are less than or equal to, so p50 of 100 is the 50th and p99 of 100 the 99th
+    static float percentile(const std::vector<float> &sorted, float p) {
+        std::size_t rank = std::max((std::size_t) std::ceil(p * sorted.size()), (std::size_t) 1);
+        return sorted[std::min(rank, sorted.size()) - 1];
+    }
+
+private:
+    std::vector<float> times;
+};
+
+#endif //PROJECT_BASE_FRAMETIMES_H
@@ -0,0 +1,52 @@
+#ifndef PROJECT_BASE_FRUSTUM_H
+#define PROJECT_BASE_FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+// The six planes of a view frustum, taken from the rows of a projection * view matrix, for
+// rejecting world space boxes that can't be on screen.
+struct Frustum {
+    // (normal, distance), pointing inside
+    glm::vec4 planes[6];
+
+    explicit Frustum(const glm::mat4 &viewProjection) {
+        glm::vec4 w(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+        for (int i = 0; i < 3; i++) {
+            glm::vec4 row(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+            planes[2 * i] = w + row;
+            planes[2 * i + 1] = w - row;
+        }
+    }
+
+    // false only when the box is completely outside one of the planes
+    bool intersects(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax) const {
+        for (const glm::vec4 &plane : planes) {
+            // the box corner furthest along the plane normal
+            glm::vec3 corner(plane.x > 0.0f ? boundsMax.x : boundsMin.x,
+                             plane.y > 0.0f ? boundsMax.y : boundsMin.y,
+                             plane.z > 0.0f ? boundsMax.z : boundsMin.z);
+            if (plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w < 0.0f)
+                return false;
+        }
+        return true;
+    }
+
+    // box around the eight corners of a model space box moved by transform
+    static void transformBounds(const glm::mat4 &transform, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax,
+                                glm::vec3 &worldMin, glm::vec3 &worldMax) {
+        worldMin = glm::vec3(INFINITY);
+        worldMax = glm::vec3(-INFINITY);
+        for (int corner = 0; corner < 8; corner++) {
+            glm::vec3 point(corner & 1 ? boundsMax.x : boundsMin.x,
+                            corner & 2 ? boundsMax.y : boundsMin.y,
+                            corner & 4 ? boundsMax.z : boundsMin.z);
+            point = glm::vec3(transform * glm::vec4(point, 1.0f));
+            worldMin = glm::min(worldMin, point);
+            worldMax = glm::max(worldMax, point);
+        }
+    }
+};
+
+#endif //PROJECT_BASE_FRUSTUM_H
@@ -0,0 +1,155 @@
+#ifndef PROJECT_BASE_GLEXTENSIONS_H
+#define PROJECT_BASE_GLEXTENSIONS_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+#include <iostream>
+
+// glad is generated for core 3.3 only, entry points and enums from newer versions or
+// extensions that we can make use of are loaded here when the driver offers them.
+
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_TEXTURE_BUFFER_OFFSET_ALIGNMENT
+#define GL_TEXTURE_BUFFER_OFFSET_ALIGNMENT 0x919F
+#endif
+
+typedef void (APIENTRYP PFNRGMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride);
+typedef void (APIENTRYP PFNRGGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP PFNRGPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP PFNRGPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP PFNRGMAXSHADERCOMPILERTHREADSPROC)(GLuint count);
+typedef void (APIENTRYP PFNRGBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+typedef void (APIENTRYP PFNRGTEXBUFFERRANGEPROC)(GLenum target, GLenum internalformat, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+struct GLExtensions {
+    int majorVersion = 0;
+    int minorVersion = 0;
+
+    // GL 4.3 or ARB_multi_draw_indirect + ARB_base_instance, and for the shaders ARB_shader_storage_buffer_object
+    // + ARB_shading_language_420pack
+    bool multiDrawIndirect = false;
+    PFNRGMULTIDRAWELEMENTSINDIRECTPROC MultiDrawElementsIndirect = nullptr;
+
+    // GL 4.1 or ARB_get_program_binary, with at least one binary format
+    bool programBinary = false;
+    PFNRGGETPROGRAMBINARYPROC GetProgramBinary = nullptr;
+    PFNRGPROGRAMBINARYPROC ProgramBinary = nullptr;
+    PFNRGPROGRAMPARAMETERIPROC ProgramParameteri = nullptr;
+
+    // KHR_parallel_shader_compile or ARB_parallel_shader_compile: compiles and links run on driver
+    // threads and GL_COMPLETION_STATUS_KHR tells, without blocking, when they are done
+    bool parallelShaderCompile = false;
+
+    // GL 4.4 or ARB_buffer_storage: immutable buffers that can stay mapped while the GPU reads them
+    bool bufferStorage = false;
+    PFNRGBUFFERSTORAGEPROC BufferStorage = nullptr;
+
+    // GL 4.3 or ARB_texture_buffer_range: buffer textures over part of a buffer
+    bool textureBufferRange = false;
+    PFNRGTEXBUFFERRANGEPROC TexBufferRange = nullptr;
+
+    bool version(int major, int minor) const {
+        return majorVersion > major || (majorVersion == major && minorVersion >= minor);
+    }
+
+    bool hasExtension(const char *name) const {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++) {
+            const char *extension = (const char *) glGetStringi(GL_EXTENSIONS, i);
+            if (extension && std::strcmp(extension, name) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    // must be called with a current context, after gladLoadGLLoader
+    void load(GLADloadproc loader) {
+        glGetIntegerv(GL_MAJOR_VERSION, &majorVersion);
+        glGetIntegerv(GL_MINOR_VERSION, &minorVersion);
+
+        // the multi draw shaders are GLSL 3.30 and take storage buffers and binding layouts from
+        // extensions, which a 4.3 driver lists as well
+        if ((version(4, 3) || (hasExtension("GL_ARB_multi_draw_indirect") && hasExtension("GL_ARB_base_instance"))) &&
+            hasExtension("GL_ARB_shader_storage_buffer_object") && hasExtension("GL_ARB_shading_language_420pack")) {
+            MultiDrawElementsIndirect = (PFNRGMULTIDRAWELEMENTSINDIRECTPROC) loader("glMultiDrawElementsIndirect");
+            multiDrawIndirect = MultiDrawElementsIndirect != nullptr;
+        }
+
+        if (version(4, 1) || hasExtension("GL_ARB_get_program_binary")) {
+            GLint formats = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            GetProgramBinary = (PFNRGGETPROGRAMBINARYPROC) loader("glGetProgramBinary");
+            ProgramBinary = (PFNRGPROGRAMBINARYPROC) loader("glProgramBinary");
+            ProgramParameteri = (PFNRGPROGRAMPARAMETERIPROC) loader("glProgramParameteri");
+            programBinary = formats > 0 && GetProgramBinary && ProgramBinary && ProgramParameteri;
+        }
+
+        PFNRGMAXSHADERCOMPILERTHREADSPROC MaxShaderCompilerThreads = nullptr;
+        if (hasExtension("GL_KHR_parallel_shader_compile"))
+            MaxShaderCompilerThreads = (PFNRGMAXSHADERCOMPILERTHREADSPROC) loader("glMaxShaderCompilerThreadsKHR");
+        else if (hasExtension("GL_ARB_parallel_shader_compile"))
+            MaxShaderCompilerThreads = (PFNRGMAXSHADERCOMPILERTHREADSPROC) loader("glMaxShaderCompilerThreadsARB");
+        if (MaxShaderCompilerThreads) {
+            // as many threads as the driver wants to use
+            MaxShaderCompilerThreads(0xFFFFFFFFu);
+            parallelShaderCompile = true;
+        }
+
+        if (version(4, 4) || hasExtension("GL_ARB_buffer_storage")) {
+            BufferStorage = (PFNRGBUFFERSTORAGEPROC) loader("glBufferStorage");
+            bufferStorage = BufferStorage != nullptr;
+        }
+
+        if (version(4, 3) || hasExtension("GL_ARB_texture_buffer_range")) {
+            TexBufferRange = (PFNRGTEXBUFFERRANGEPROC) loader("glTexBufferRange");
+            textureBufferRange = TexBufferRange != nullptr;
+        }
+
+        std::cout << "OpenGL " << majorVersion << "." << minorVersion << " (" << glGetString(GL_RENDERER) << ")"
+                  << ", multi draw indirect: " << (multiDrawIndirect ? "yes" : "no")
+                  << ", program binaries: " << (programBinary ? "yes" : "no")
+                  << ", parallel shader compile: " << (parallelShaderCompile ? "yes" : "no")
+                  << ", persistent mapping: " << (bufferStorage ? "yes" : "no")
+                  << ", texture buffer range: " << (textureBufferRange ? "yes" : "no") << std::endl;
+    }
+};
+
+GLExtensions &glExtensions() {
+    static GLExtensions extensions;
+    return extensions;
+}
+
+#endif //PROJECT_BASE_GLEXTENSIONS_H
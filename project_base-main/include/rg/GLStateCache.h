@@ -0,0 +1,241 @@
+#ifndef PROJECT_BASE_GLSTATECACHE_H
+#define PROJECT_BASE_GLSTATECACHE_H
+
+#include <glad/glad.h>
+
+#include <rg/RenderStats.h>
+
+#include <iostream>
+
+// Shadow copy of the GL state the renderer changes while drawing: bound program, vertex array,
+// textures of each unit, depth/blend/cull state and viewport. Calls that would set what is already
+// set are dropped, every call counts as issued or elided so the saved driver work shows up.
+// Code that changes any of this state directly must call invalidate() afterwards.
+class GLStateCache {
+public:
+    static const unsigned int MAX_TEXTURE_UNITS = 16;
+
+    struct Counters {
+        unsigned long long issued = 0;
+        unsigned long long elided = 0;
+    };
+
+    // counts of the frame in progress and of the last finished one
+    Counters counters;
+    Counters lastFrame;
+
+    GLStateCache() {
+        invalidate();
+    }
+
+    // forgets everything, the next call of each kind goes to GL
+    void invalidate() {
+        program = UNKNOWN;
+        vertexArray = UNKNOWN;
+        activeUnit = UNKNOWN;
+        for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+            for (unsigned int target = 0; target < NUM_TARGETS; target++)
+                textures[unit][target] = UNKNOWN;
+        depthTestEnabled = cullFaceEnabled = blendEnabled = UNKNOWN_FLAG;
+        depthWrite = colorWrite = UNKNOWN_FLAG;
+        depthFunction = cullMode = UNKNOWN;
+        blendSource = blendDestination = UNKNOWN;
+        viewportX = viewportY = viewportWidth = viewportHeight = -1;
+    }
+
+    // call once per frame, moves the counters into lastFrame
+    void beginFrame() {
+        lastFrame = counters;
+        counters = Counters();
+    }
+
+    void useProgram(GLuint id) {
+        if (changed(program, id)) {
+            renderStats().programSwitch();
+            glUseProgram(id);
+        }
+    }
+
+    void bindVertexArray(GLuint id) {
+        if (changed(vertexArray, id))
+            glBindVertexArray(id);
+    }
+
+    void activeTexture(unsigned int unit) {
+        if (changed(activeUnit, unit))
+            glActiveTexture(GL_TEXTURE0 + unit);
+    }
+
+    // binds texture to target of the unit, the active unit is only switched when the binding changes
+    void bindTexture(unsigned int unit, GLenum target, GLuint texture) {
+        int t = targetIndex(target);
+        if (unit >= MAX_TEXTURE_UNITS || t < 0) {
+            activeTexture(unit);
+            issue();
+            renderStats().textureBind();
+            glBindTexture(target, texture);
+            return;
+        }
+        if (textures[unit][t] == texture) {
+            counters.elided++;
+            return;
+        }
+        activeTexture(unit);
+        issue();
+        renderStats().textureBind();
+        glBindTexture(target, texture);
+        textures[unit][t] = texture;
+    }
+
+    // for GL_DEPTH_TEST, GL_CULL_FACE and GL_BLEND, anything else goes straight to GL
+    void setEnabled(GLenum capability, bool enabled) {
+        int *flag = capabilityFlag(capability);
+        if (flag && !changed(*flag, enabled ? 1 : 0))
+            return;
+        if (!flag)
+            issue();
+        if (enabled)
+            glEnable(capability);
+        else
+            glDisable(capability);
+    }
+
+    bool isEnabled(GLenum capability) {
+        int *flag = capabilityFlag(capability);
+        if (!flag)
+            return glIsEnabled(capability);
+        if (*flag == UNKNOWN_FLAG)
+            *flag = glIsEnabled(capability) ? 1 : 0;
+        return *flag == 1;
+    }
+
+    void depthMask(bool write) {
+        if (changed(depthWrite, write ? 1 : 0))
+            glDepthMask(write ? GL_TRUE : GL_FALSE);
+    }
+
+    bool depthMaskEnabled() {
+        if (depthWrite == UNKNOWN_FLAG) {
+            GLboolean write;
+            glGetBooleanv(GL_DEPTH_WRITEMASK, &write);
+            depthWrite = write ? 1 : 0;
+        }
+        return depthWrite == 1;
+    }
+
+    // all four channels at once, the renderer never masks single channels
+    void colorMask(bool write) {
+        if (changed(colorWrite, write ? 1 : 0)) {
+            GLboolean value = write ? GL_TRUE : GL_FALSE;
+            glColorMask(value, value, value, value);
+        }
+    }
+
+    bool colorMaskEnabled() {
+        if (colorWrite == UNKNOWN_FLAG) {
+            GLboolean write[4];
+            glGetBooleanv(GL_COLOR_WRITEMASK, write);
+            colorWrite = write[0] ? 1 : 0;
+        }
+        return colorWrite == 1;
+    }
+
+    void depthFunc(GLenum function) {
+        if (changed(depthFunction, function))
+            glDepthFunc(function);
+    }
+
+    void cullFace(GLenum mode) {
+        if (changed(cullMode, mode))
+            glCullFace(mode);
+    }
+
+    void blendFunc(GLenum source, GLenum destination) {
+        if (blendSource == source && blendDestination == destination) {
+            counters.elided++;
+            return;
+        }
+        issue();
+        glBlendFunc(source, destination);
+        blendSource = source;
+        blendDestination = destination;
+    }
+
+    void viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+        if (viewportX == x && viewportY == y && viewportWidth == width && viewportHeight == height) {
+            counters.elided++;
+            return;
+        }
+        issue();
+        glViewport(x, y, width, height);
+        viewportX = x;
+        viewportY = y;
+        viewportWidth = width;
+        viewportHeight = height;
+    }
+
+    void printLastFrame() const {
+        unsigned long long total = lastFrame.issued + lastFrame.elided;
+        std::cout << "GL state calls: " << lastFrame.issued << " issued, " << lastFrame.elided << " elided";
+        if (total)
+            std::cout << " (" << 100 * lastFrame.elided / total << "% saved)";
+        std::cout << std::endl;
+    }
+
+private:
+    static const GLuint UNKNOWN = 0xFFFFFFFFu;
+    static const int UNKNOWN_FLAG = -1;
+    static const unsigned int NUM_TARGETS = 4;
+
+    GLuint program, vertexArray, activeUnit;
+    GLuint textures[MAX_TEXTURE_UNITS][NUM_TARGETS];
+    int depthTestEnabled, cullFaceEnabled, blendEnabled;
+    int depthWrite, colorWrite;
+    GLenum depthFunction, cullMode;
+    GLenum blendSource, blendDestination;
+    GLint viewportX, viewportY;
+    GLsizei viewportWidth, viewportHeight;
+
+    void issue() {
+        counters.issued++;
+        renderStats().stateChange();
+    }
+
+    // stores value and returns true if it differs from the cached one, counts the call either way
+    template <typename T>
+    bool changed(T &cached, T value) {
+        if (cached == value) {
+            counters.elided++;
+            return false;
+        }
+        issue();
+        cached = value;
+        return true;
+    }
+
+    static int targetIndex(GLenum target) {
+        switch (target) {
+            case GL_TEXTURE_2D: return 0;
+            case GL_TEXTURE_CUBE_MAP: return 1;
+            case GL_TEXTURE_2D_ARRAY: return 2;
+            case GL_TEXTURE_BUFFER: return 3;
+            default: return -1;
+        }
+    }
+
+    int *capabilityFlag(GLenum capability) {
+        switch (capability) {
+            case GL_DEPTH_TEST: return &depthTestEnabled;
+            case GL_CULL_FACE: return &cullFaceEnabled;
+            case GL_BLEND: return &blendEnabled;
+            default: return nullptr;
+        }
+    }
+};
+
+GLStateCache &glState() {
+    static GLStateCache state;
+    return state;
+}
+
+#endif //PROJECT_BASE_GLSTATECACHE_H
@@ -0,0 +1,228 @@
+#ifndef PROJECT_BASE_GPUPROFILER_H
+#define PROJECT_BASE_GPUPROFILER_H
+
+#include <glad/glad.h>
+
+#include <rg/FrameTimes.h>
+#include <rg/RenderStats.h>
+
+#include <string>
+#include <vector>
+
+// GPU time of the named passes of a frame. begin(name) and end() put a GL_TIMESTAMP query before
+// and after a pass; passes may nest, a pass inside another shows up under it. The queries of a
+// frame are read FRAMES_IN_FLIGHT frames later once the last one is available, so profiling never
+// waits for the GPU; a frame that finds its slot still waiting is simply not profiled.
+// Every pass keeps its last SAMPLES times for a rolling average, the whole frame its last HISTORY.
+// The passes are also the passes of renderStats(), which counts them whether or not they are timed.
+class GpuProfiler {
+public:
+    static const unsigned int FRAMES_IN_FLIGHT = 4;
+    static const unsigned int SAMPLES = 120;
+    static const unsigned int HISTORY = 240;
+
+    struct Pass {
+        std::string name;
+        // how many passes it is nested in
+        unsigned int depth;
+        // last SAMPLES times in milliseconds, the oldest one is overwritten next
+        std::vector<float> samples;
+        unsigned int nextSample = 0;
+        // number of the last profiled frame it was drawn in
+        unsigned long long lastFrame = 0;
+
+        float average() const {
+            if (samples.empty())
+                return 0.0f;
+            float sum = 0.0f;
+            for (float sample : samples)
+                sum += sample;
+            return sum / samples.size();
+        }
+    };
+
+    GpuProfiler() = default;
+
+    ~GpuProfiler() {
+        for (Frame &frame : frames)
+            if (!frame.queries.empty())
+                glDeleteQueries(frame.queries.size(), frame.queries.data());
+    }
+
+    GpuProfiler(const GpuProfiler &) = delete;
+    GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+    // reads what the GPU finished and starts the frame; call before its first pass
+    void beginFrame() {
+        collect();
+        Frame &frame = frames[current];
+        recording = !frame.pending;
+        if (!recording)
+            return;
+        frame.records.clear();
+        frame.used = 0;
+        open.clear();
+        frame.begin = timestamp(frame);
+    }
+
+    // name must outlive the profiler, passes are told apart by name and nesting depth
+    void begin(const char *name) {
+        renderStats().beginPass(name);
+        if (!recording)
+            return;
+        Frame &frame = frames[current];
+        frame.records.push_back(Record{passIndex(name, open.size()), timestamp(frame), 0});
+        open.push_back(frame.records.size() - 1);
+    }
+
+    // ends the innermost pass begun and not yet ended
+    void end() {
+        renderStats().endPass();
+        if (!recording || open.empty())
+            return;
+        Frame &frame = frames[current];
+        frame.records[open.back()].end = timestamp(frame);
+        open.pop_back();
+    }
+
+    void endFrame() {
+        if (!recording)
+            return;
+        Frame &frame = frames[current];
+        frame.end = timestamp(frame);
+        frame.pending = true;
+        frame.number = ++recorded;
+        current = (current + 1) % FRAMES_IN_FLIGHT;
+        recording = false;
+    }
+
+    // in the order they were first begun, which is the order of the frame
+    const std::vector<Pass> &passes() const {
+        return passList;
+    }
+
+    // whether pass was drawn in the newest profiled frame that has been read back
+    bool active(const Pass &pass) const {
+        return pass.lastFrame == collected && collected > 0;
+    }
+
+    // rolling average of the pass called name, 0 if there is none
+    float average(const char *name) const {
+        for (const Pass &pass : passList)
+            if (pass.name == name && active(pass))
+                return pass.average();
+        return 0.0f;
+    }
+
+    // every whole frame read back from now on also goes into times, null stops it
+    void recordFrameTimes(FrameTimes *times) {
+        frameTimeRecord = times;
+    }
+
+    // GPU time of the last HISTORY whole frames, oldest first
+    std::vector<float> frameHistory() const {
+        std::vector<float> history(frameTimes.begin() + nextFrameTime, frameTimes.end());
+        history.insert(history.end(), frameTimes.begin(), frameTimes.begin() + nextFrameTime);
+        return history;
+    }
+
+private:
+    struct Record {
+        unsigned int pass;
+        // indices into the queries of the frame
+        unsigned int begin, end;
+    };
+
+    struct Frame {
+        // grows to the most timestamps a frame used, the names are reused afterwards
+        std::vector<unsigned int> queries;
+        unsigned int used = 0;
+        std::vector<Record> records;
+        unsigned int begin = 0, end = 0;
+        bool pending = false;
+        unsigned long long number = 0;
+    };
+
+    Frame frames[FRAMES_IN_FLIGHT];
+    unsigned int current = 0;
+    bool recording = false;
+    std::vector<unsigned int> open;
+    std::vector<Pass> passList;
+    std::vector<GLuint64> results;
+    std::vector<float> frameTimes;
+    unsigned int nextFrameTime = 0;
+    unsigned long long recorded = 0, collected = 0;
+    FrameTimes *frameTimeRecord = nullptr;
+
+    static unsigned int timestamp(Frame &frame) {
+        if (frame.used == frame.queries.size()) {
+            unsigned int query;
+            glGenQueries(1, &query);
+            frame.queries.push_back(query);
+        }
+        glQueryCounter(frame.queries[frame.used], GL_TIMESTAMP);
+        return frame.used++;
+    }
+
+    unsigned int passIndex(const char *name, unsigned int depth) {
+        for (unsigned int i = 0; i < passList.size(); i++)
+            if (passList[i].depth == depth && passList[i].name == name)
+                return i;
+        passList.push_back(Pass{name, depth, {}, 0, 0});
+        return passList.size() - 1;
+    }
+
+    // reads the pending frames oldest first, up to the first one the GPU hasn't finished
+    void collect() {
+        for (unsigned int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+            Frame &frame = frames[(current + i) % FRAMES_IN_FLIGHT];
+            if (!frame.pending)
+                continue;
+            // the last timestamp of a frame is available only once all of them are
+            GLuint available = 0;
+            glGetQueryObjectuiv(frame.queries[frame.end], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                return;
+
+            results.resize(frame.used);
+            for (unsigned int q = 0; q < frame.used; q++)
+                glGetQueryObjectui64v(frame.queries[q], GL_QUERY_RESULT, &results[q]);
+            for (const Record &record : frame.records)
+                addSample(passList[record.pass], milliseconds(record.begin, record.end), frame.number);
+            addFrameTime(milliseconds(frame.begin, frame.end));
+            collected = frame.number;
+            frame.pending = false;
+        }
+    }
+
+    float milliseconds(unsigned int begin, unsigned int end) const {
+        return results[end] > results[begin] ? (results[end] - results[begin]) / 1.0e6f : 0.0f;
+    }
+
+    static void addSample(Pass &pass, float ms, unsigned long long frame) {
+        // a pass begun twice in a frame counts as one
+        if (pass.lastFrame == frame && !pass.samples.empty()) {
+            pass.samples[(pass.nextSample + SAMPLES - 1) % SAMPLES] += ms;
+            return;
+        }
+        if (pass.samples.size() < SAMPLES)
+            pass.samples.push_back(ms);
+        else
+            pass.samples[pass.nextSample] = ms;
+        pass.nextSample = (pass.nextSample + 1) % SAMPLES;
+        pass.lastFrame = frame;
+    }
+
+    void addFrameTime(float ms) {
+        if (frameTimeRecord)
+            frameTimeRecord->add(ms);
+        if (frameTimes.size() < HISTORY) {
+            frameTimes.push_back(ms);
+            return;
+        }
+        frameTimes[nextFrameTime] = ms;
+        nextFrameTime = (nextFrameTime + 1) % HISTORY;
+    }
+};
+
+#endif //PROJECT_BASE_GPUPROFILER_H
@@ -0,0 +1,96 @@
+#ifndef PROJECT_BASE_GPUTIMER_H
+#define PROJECT_BASE_GPUTIMER_H
+
+#include <glad/glad.h>
+
+// Measures the GPU time of the commands between begin() and end() with a GL_TIMESTAMP query at
+// each end. Results are read a few frames later once they are available, so timing never stalls
+// the CPU, and are smoothed into a running average. Unlike GL_TIME_ELAPSED queries, of which only
+// one may be active, timestamps let timers overlap, e.g. one for the frame around one per pass.
+class GpuTimer {
+public:
+    static const unsigned int QUERY_RING_SIZE = 4;
+
+    GpuTimer() {
+        glGenQueries(QUERY_RING_SIZE * 2, &queries[0][0]);
+    }
+
+    ~GpuTimer() {
+        glDeleteQueries(QUERY_RING_SIZE * 2, &queries[0][0]);
+    }
+
+    GpuTimer(const GpuTimer &) = delete;
+    GpuTimer &operator=(const GpuTimer &) = delete;
+
+    void begin() {
+        collect();
+        // every query of the ring is still in flight, skip this frame
+        active = !pending[next];
+        if (active)
+            glQueryCounter(queries[next][0], GL_TIMESTAMP);
+    }
+
+    void end() {
+        if (!active)
+            return;
+        glQueryCounter(queries[next][1], GL_TIMESTAMP);
+        pending[next] = true;
+        next = (next + 1) % QUERY_RING_SIZE;
+        active = false;
+    }
+
+    // running average in milliseconds, 0 until the first result arrives
+    double milliseconds() const {
+        return average;
+    }
+
+    // the newest result in milliseconds, not averaged
+    double lastMilliseconds() const {
+        return last;
+    }
+
+    // results read so far, tells a caller polling every frame whether lastMilliseconds() is new
+    unsigned long long resultCount() const {
+        return results;
+    }
+
+    // forgets the average, e.g. after switching what is being measured
+    void reset() {
+        average = 0.0;
+    }
+
+private:
+    // begin and end timestamp per slot
+    unsigned int queries[QUERY_RING_SIZE][2];
+    bool pending[QUERY_RING_SIZE] = {false};
+    unsigned int next = 0;
+    bool active = false;
+    double average = 0.0;
+    double last = 0.0;
+    unsigned long long results = 0;
+
+    void collect() {
+        for (unsigned int i = 0; i < QUERY_RING_SIZE; i++) {
+            unsigned int slot = (next + i) % QUERY_RING_SIZE;
+            if (!pending[slot])
+                continue;
+
+            // the end timestamp comes after the begin one, once it is there both are
+            GLuint available = 0;
+            glGetQueryObjectuiv(queries[slot][1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                break;
+
+            GLuint64 begin = 0, end = 0;
+            glGetQueryObjectui64v(queries[slot][0], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(queries[slot][1], GL_QUERY_RESULT, &end);
+            double ms = (end - begin) / 1.0e6;
+            average = average == 0.0 ? ms : average * 0.95 + ms * 0.05;
+            last = ms;
+            results++;
+            pending[slot] = false;
+        }
+    }
+};
+
+#endif //PROJECT_BASE_GPUTIMER_H
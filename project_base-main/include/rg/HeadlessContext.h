@@ -0,0 +1,176 @@
+#ifndef PROJECT_BASE_HEADLESSCONTEXT_H
+#define PROJECT_BASE_HEADLESSCONTEXT_H
+
+#include <glad/glad.h>
+
+#ifdef PROJECT_BASE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+// OpenGL 3.3 core context without a window or display, for running the scene where there is no
+// screen (CI machines, Mesa's llvmpipe). The context is surfaceless EGL, so it has no default
+// framebuffer; frames go into a framebuffer object of the requested size with the same colour
+// and GL_DEPTH24_STENCIL8 depth a window would have, and can be read back into an image file.
+// Needs the build to find EGL, which defines PROJECT_BASE_EGL; without it create() fails.
+class HeadlessContext {
+public:
+    HeadlessContext() = default;
+
+    ~HeadlessContext() {
+#ifdef PROJECT_BASE_EGL
+        if (context != EGL_NO_CONTEXT) {
+            glDeleteFramebuffers(1, &target);
+            glDeleteRenderbuffers(2, renderbuffers);
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            eglDestroyContext(display, context);
+        }
+        if (display != EGL_NO_DISPLAY)
+            eglTerminate(display);
+#endif
+    }
+
+    HeadlessContext(const HeadlessContext &) = delete;
+    HeadlessContext &operator=(const HeadlessContext &) = delete;
+
+    // what glad and GLExtensions load the functions with, null without EGL
+    static GLADloadproc loader() {
+#ifdef PROJECT_BASE_EGL
+        return (GLADloadproc) eglGetProcAddress;
+#else
+        return nullptr;
+#endif
+    }
+
+    // creates the context, makes it current, loads GL through glad and creates the render target
+    bool create(int targetWidth, int targetHeight) {
+#ifdef PROJECT_BASE_EGL
+        width = targetWidth;
+        height = targetHeight;
+        // the Mesa surfaceless platform needs no display server, other drivers get their default display
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+                (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay)
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display == EGL_NO_DISPLAY)
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        EGLint major, minor;
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+            std::cout << "ERROR::HEADLESS::NO_EGL_DISPLAY" << std::endl;
+            return false;
+        }
+        if (!eglBindAPI(EGL_OPENGL_API)) {
+            std::cout << "ERROR::HEADLESS::NO_OPENGL_API" << std::endl;
+            return false;
+        }
+
+        const EGLint configAttributes[] = {
+                EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+                EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                EGL_NONE
+        };
+        EGLConfig config;
+        EGLint configCount = 0;
+        if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+            std::cout << "ERROR::HEADLESS::NO_EGL_CONFIG" << std::endl;
+            return false;
+        }
+        const EGLint contextAttributes[] = {
+                EGL_CONTEXT_MAJOR_VERSION, 3,
+                EGL_CONTEXT_MINOR_VERSION, 3,
+                EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                EGL_NONE
+        };
+        context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+        if (context == EGL_NO_CONTEXT) {
+            std::cout << "ERROR::HEADLESS::CONTEXT_CREATION_FAILED: 0x" << std::hex << eglGetError() << std::dec
+                      << std::endl;
+            return false;
+        }
+        // surfaceless, EGL_KHR_surfaceless_context
+        if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+            std::cout << "ERROR::HEADLESS::MAKE_CURRENT_FAILED" << std::endl;
+            return false;
+        }
+        if (!gladLoadGLLoader(loader())) {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return false;
+        }
+        std::cout << "headless: EGL " << major << '.' << minor << ", " << glGetString(GL_RENDERER) << ", "
+                  << width << 'x' << height << std::endl;
+        return createTarget();
+#else
+        std::cout << "ERROR::HEADLESS::BUILT_WITHOUT_EGL" << std::endl;
+        return false;
+#endif
+    }
+
+    // what a window's framebuffer 0 would be
+    unsigned int framebuffer() const {
+        return target;
+    }
+
+    int framebufferWidth() const {
+        return width;
+    }
+
+    int framebufferHeight() const {
+        return height;
+    }
+
+    // reads the render target back and writes it as a binary PPM, top row first
+    bool writePPM(const std::string &path) const {
+        std::vector<unsigned char> pixels((std::size_t) width * height * 3);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, target);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+        std::ofstream file(path, std::ios::binary);
+        if (!file) {
+            std::cout << "ERROR::HEADLESS::CANNOT_WRITE_IMAGE: " << path << std::endl;
+            return false;
+        }
+        file << "P6\n" << width << ' ' << height << "\n255\n";
+        // GL's first row is the bottom one
+        for (int row = height - 1; row >= 0; row--)
+            file.write((const char *) pixels.data() + (std::size_t) row * width * 3, width * 3);
+        return true;
+    }
+
+private:
+#ifdef PROJECT_BASE_EGL
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+#endif
+    int width = 0, height = 0;
+    unsigned int target = 0;
+    // colour and depth
+    unsigned int renderbuffers[2] = {0, 0};
+
+    bool createTarget() {
+        glGenFramebuffers(1, &target);
+        glBindFramebuffer(GL_FRAMEBUFFER, target);
+        glGenRenderbuffers(2, renderbuffers);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "ERROR::HEADLESS::FRAMEBUFFER_INCOMPLETE" << std::endl;
+            return false;
+        }
+        return true;
+    }
+};
+
+#endif //PROJECT_BASE_HEADLESSCONTEXT_H
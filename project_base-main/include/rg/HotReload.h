@@ -0,0 +1,154 @@
+#ifndef PROJECT_BASE_HOTRELOAD_H
+#define PROJECT_BASE_HOTRELOAD_H
+
+#include <learnopengl/model.h>
+#include <learnopengl/shader.h>
+#include <rg/CpuProfiler.h>
+#include <rg/FileWatcher.h>
+#include <rg/GLStateCache.h>
+#include <rg/ShaderVariants.h>
+#include <rg/StaticBatches.h>
+#include <rg/StaticDrawList.h>
+
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+// Picks up edits of the scene's shaders, model files and model textures while it runs. Only the
+// directories of registered files are watched, and only what a changed file feeds is rebuilt: the
+// programs compiled from a shader, the one texture decoded from an image, the model imported from
+// an .obj or its .mtl. Everything is replaced in place between frames, so the Shader and Model
+// objects the renderer holds stay valid, and a replacement that fails to build keeps the old one.
+// A model in the static draw list makes the list rebuild its shared buffers and texture arrays, a
+// model baked into the static batches makes them merge again.
+class HotReload {
+public:
+    explicit HotReload(StaticDrawList *staticDrawList = nullptr, StaticBatches *staticBatches = nullptr)
+            : staticDrawList(staticDrawList), staticBatches(staticBatches) {
+    }
+
+    void add(Shader &shader) {
+        shaders.push_back(&shader);
+        for (const std::string &file : shader.files())
+            watchDirectoryOf(file);
+    }
+
+    void add(ShaderVariants &variants) {
+        variantSets.push_back(&variants);
+        for (const std::string &file : variants.files())
+            watchDirectoryOf(file);
+    }
+
+    void add(Model &model) {
+        models.push_back(&model);
+        watchDirectoryOf(model.path);
+        // material textures can sit in subdirectories of the model
+        for (const Texture &texture : model.textures_loaded)
+            watchDirectoryOf(model.directory + "/" + texture.path);
+    }
+
+    unsigned int directoryCount() const {
+        return watcher.directoryCount();
+    }
+
+    // call once per frame before anything is drawn; returns whether a changed file was picked up
+    bool update() {
+        std::vector<std::string> changed = watcher.poll();
+        if (changed.empty())
+            return false;
+        PROFILE_SCOPE("hot reload");
+
+        std::set<Model *> imports;
+        std::set<Model *> retextured;
+        for (const std::string &file : changed) {
+            reloadShaders(file);
+            for (Model *model : models)
+                if (file == model->path || (isMaterialFile(file) && directoryOf(file) == model->directory))
+                    imports.insert(model);
+        }
+        // textures of a model imported again are loaded with it
+        for (const std::string &file : changed)
+            for (Model *model : models)
+                if (!imports.count(model) && reloadTexture(*model, file))
+                    retextured.insert(model);
+
+        bool rebuildStaticList = false, rebuildBatches = false;
+        for (Model *model : imports) {
+            if (model->Reload()) {
+                std::cout << "hot reload: imported " << model->path << " again" << std::endl;
+                rebuildStaticList |= staticDrawList && staticDrawList->contains(*model);
+                rebuildBatches |= staticBatches && staticBatches->contains(*model);
+            } else {
+                std::cout << "ERROR::HOT_RELOAD::IMPORT_FAILED, keeping the previous version: " << model->path << std::endl;
+            }
+        }
+        for (Model *model : retextured)
+            rebuildStaticList |= staticDrawList && staticDrawList->contains(*model);
+        if (rebuildStaticList)
+            staticDrawList->rebuild();
+        // the batches only hold texture names, a texture decoded again needs nothing
+        if (rebuildBatches)
+            staticBatches->build();
+        // programs, textures and vertex arrays were deleted and created behind the state cache
+        glState().invalidate();
+        return true;
+    }
+
+private:
+    FileWatcher watcher;
+    StaticDrawList *staticDrawList;
+    StaticBatches *staticBatches;
+    std::vector<Shader *> shaders;
+    std::vector<ShaderVariants *> variantSets;
+    std::vector<Model *> models;
+
+    void reloadShaders(const std::string &file) {
+        unsigned int reloaded = 0, failed = 0;
+        for (Shader *shader : shaders) {
+            if (!shader->usesFile(file))
+                continue;
+            if (shader->reload())
+                reloaded++;
+            else
+                failed++;
+        }
+        for (ShaderVariants *variants : variantSets)
+            reloaded += variants->reload(file, &failed);
+        if (reloaded + failed == 0)
+            return;
+        std::cout << "hot reload: " << file << ", " << reloaded << " programs rebuilt" << std::endl;
+        if (failed)
+            std::cout << "ERROR::HOT_RELOAD::" << failed << " programs kept their previous version" << std::endl;
+    }
+
+    bool reloadTexture(Model &model, const std::string &file) {
+        for (const Texture &texture : model.textures_loaded) {
+            if (model.directory + "/" + texture.path != file)
+                continue;
+            if (!LoadTextureFile(texture.id, file)) {
+                std::cout << "ERROR::HOT_RELOAD::TEXTURE_FAILED, keeping the previous version: " << file << std::endl;
+                return false;
+            }
+            std::cout << "hot reload: " << file << " decoded again" << std::endl;
+            return true;
+        }
+        return false;
+    }
+
+    void watchDirectoryOf(const std::string &file) {
+        watcher.watch(directoryOf(file));
+    }
+
+    static std::string directoryOf(const std::string &file) {
+        std::size_t slash = file.find_last_of('/');
+        return slash == std::string::npos ? "." : file.substr(0, slash);
+    }
+
+    static bool isMaterialFile(const std::string &file) {
+        const std::string extension = ".mtl";
+        return file.size() > extension.size() && file.compare(file.size() - extension.size(), extension.size(), extension) == 0;
+    }
+};
+
+#endif //PROJECT_BASE_HOTRELOAD_H
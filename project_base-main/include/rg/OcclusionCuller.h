@@ -0,0 +1,217 @@
+#ifndef PROJECT_BASE_OCCLUSIONCULLER_H
+#define PROJECT_BASE_OCCLUSIONCULLER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/shader.h>
+#include <rg/GLStateCache.h>
+#include <rg/RenderStats.h>
+
+#include <vector>
+
+// GPU occlusion culling for expensive models (lanterns, island, campfire).
+// Every frame the bounding box of an object is drawn as an invisible proxy inside a
+// GL_ANY_SAMPLES_PASSED query. Objects that were visible according to the last result
+// we read back are drawn straight away (temporal coherence), the rest are drawn inside
+// glBeginConditionalRender so the GPU drops them when the proxy produced no samples.
+// Each object owns a small ring of queries and results are only read once GL reports
+// them available, so the CPU never waits for the GPU.
+class OcclusionCuller {
+public:
+    static const unsigned int QUERY_RING_SIZE = 3;
+
+    bool enabled = true;
+    // camera movement (in world units) in one frame after which old results are thrown away
+    float jumpDistance = 5.0f;
+    // proxies are grown by this much so the object never pops in when its box touches an occluder edge
+    float boundsMargin = 0.05f;
+
+    explicit OcclusionCuller(Shader &proxyShader) : proxyShader(proxyShader) {
+        setupProxy();
+    }
+
+    ~OcclusionCuller() {
+        for (Object &object : objects)
+            glDeleteQueries(QUERY_RING_SIZE, object.queries);
+        glDeleteVertexArrays(1, &proxyVAO);
+        glDeleteBuffers(1, &proxyVBO);
+    }
+
+    OcclusionCuller(const OcclusionCuller &) = delete;
+    OcclusionCuller &operator=(const OcclusionCuller &) = delete;
+
+    // registers an object by its model space bounds and returns its handle
+    unsigned int add(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax) {
+        Object object;
+        object.boundsMin = boundsMin;
+        object.boundsMax = boundsMax;
+        glGenQueries(QUERY_RING_SIZE, object.queries);
+        objects.push_back(object);
+        return objects.size() - 1;
+    }
+
+    // call once per frame before any draw()
+    void beginFrame(const glm::vec3 &cameraPosition) {
+        frame++;
+        if (glm::length(cameraPosition - lastCameraPosition) > jumpDistance)
+            invalidate();
+        lastCameraPosition = cameraPosition;
+    }
+
+    // forgets every cached result; objects count as visible until new results come back
+    void invalidate() {
+        invalidatedFrame = frame;
+        for (Object &object : objects)
+            object.visible = true;
+    }
+
+    // draws the object with the given model matrix; drawFunction must bind its own shader
+    template <typename DrawFunction>
+    void draw(unsigned int handle, const glm::mat4 &model, DrawFunction drawFunction) {
+        Object &object = objects[handle];
+        object.conditionalQuery = -1;
+        if (!enabled) {
+            drawFunction();
+            return;
+        }
+
+        collectResults(object);
+
+        // a proxy the camera is standing in gets clipped by the near plane, so it can't be trusted
+        glm::vec3 cameraInModel = glm::vec3(glm::inverse(model) * glm::vec4(lastCameraPosition, 1.0f));
+        glm::vec3 margin = (object.boundsMax - object.boundsMin) * boundsMargin;
+        if (glm::all(glm::greaterThanEqual(cameraInModel, object.boundsMin - margin)) &&
+            glm::all(glm::lessThanEqual(cameraInModel, object.boundsMax + margin))) {
+            drawFunction();
+            return;
+        }
+
+        int slot = issueQuery(object, model, margin);
+        if (object.visible || slot < 0) {
+            drawFunction();
+            return;
+        }
+
+        object.conditionalQuery = object.queries[slot];
+        glBeginConditionalRender(object.conditionalQuery, GL_QUERY_WAIT);
+        drawFunction();
+        glEndConditionalRender();
+    }
+
+    // draws the object again in a later pass of the same frame, under the same condition the last
+    // draw() used, without issuing another query
+    template <typename DrawFunction>
+    void repeat(unsigned int handle, DrawFunction drawFunction) {
+        Object &object = objects[handle];
+        if (object.conditionalQuery < 0) {
+            drawFunction();
+            return;
+        }
+
+        glBeginConditionalRender(object.conditionalQuery, GL_QUERY_WAIT);
+        drawFunction();
+        glEndConditionalRender();
+    }
+
+private:
+    struct Object {
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        unsigned int queries[QUERY_RING_SIZE];
+        // frame in which each query was issued, 0 while the slot is free
+        unsigned long long issuedFrame[QUERY_RING_SIZE] = {0};
+        unsigned int next = 0;
+        bool visible = true;
+        unsigned long long resultFrame = 0;
+        // query the last draw() was conditional on, -1 if it drew unconditionally
+        GLint conditionalQuery = -1;
+    };
+
+    Shader &proxyShader;
+    std::vector<Object> objects;
+    unsigned int proxyVAO = 0, proxyVBO = 0;
+    unsigned long long frame = 0;
+    unsigned long long invalidatedFrame = 0;
+    glm::vec3 lastCameraPosition = glm::vec3(0.0f);
+
+    // reads back every result that is ready, oldest first, and stops at the first one that isn't
+    void collectResults(Object &object) {
+        for (unsigned int i = 0; i < QUERY_RING_SIZE; i++) {
+            unsigned int slot = (object.next + i) % QUERY_RING_SIZE;
+            if (object.issuedFrame[slot] == 0)
+                continue;
+
+            GLuint available = 0;
+            glGetQueryObjectuiv(object.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                break;
+
+            GLuint anySamplesPassed = 0;
+            glGetQueryObjectuiv(object.queries[slot], GL_QUERY_RESULT, &anySamplesPassed);
+            if (object.issuedFrame[slot] > invalidatedFrame && object.issuedFrame[slot] > object.resultFrame) {
+                object.visible = anySamplesPassed != 0;
+                object.resultFrame = object.issuedFrame[slot];
+            }
+            object.issuedFrame[slot] = 0;
+        }
+    }
+
+    // draws the bounding box into the next free query of the ring, returns its slot or -1 if the ring is full
+    int issueQuery(Object &object, const glm::mat4 &model, const glm::vec3 &margin) {
+        unsigned int slot = object.next;
+        if (object.issuedFrame[slot] != 0)
+            return -1;
+
+        glm::vec3 boxMin = object.boundsMin - margin;
+        glm::vec3 boxMax = object.boundsMax + margin;
+        glm::mat4 boxModel = glm::translate(model, boxMin);
+        boxModel = glm::scale(boxModel, boxMax - boxMin);
+
+        bool colorMask = glState().colorMaskEnabled();
+        bool depthMask = glState().depthMaskEnabled();
+        bool cullFace = glState().isEnabled(GL_CULL_FACE);
+        glState().colorMask(false);
+        glState().depthMask(false);
+        glState().setEnabled(GL_CULL_FACE, false);
+
+        // projection and view come from the Frame uniform block
+        proxyShader.use();
+        proxyShader.setMat4("model"_uniform, boxModel);
+        glState().bindVertexArray(proxyVAO);
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, object.queries[slot]);
+        renderStats().drawArrays(GL_TRIANGLES, 0, 36);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+        glState().colorMask(colorMask);
+        glState().depthMask(depthMask);
+        glState().setEnabled(GL_CULL_FACE, cullFace);
+
+        object.issuedFrame[slot] = frame;
+        object.next = (slot + 1) % QUERY_RING_SIZE;
+        return slot;
+    }
+
+    // unit cube from (0, 0, 0) to (1, 1, 1), scaled onto the bounds of each object
+    void setupProxy() {
+        float cube[] = {
+                0, 0, 0,  1, 0, 0,  1, 1, 0,  1, 1, 0,  0, 1, 0,  0, 0, 0,
+                0, 0, 1,  1, 0, 1,  1, 1, 1,  1, 1, 1,  0, 1, 1,  0, 0, 1,
+                0, 1, 1,  0, 1, 0,  0, 0, 0,  0, 0, 0,  0, 0, 1,  0, 1, 1,
+                1, 1, 1,  1, 1, 0,  1, 0, 0,  1, 0, 0,  1, 0, 1,  1, 1, 1,
+                0, 0, 0,  1, 0, 0,  1, 0, 1,  1, 0, 1,  0, 0, 1,  0, 0, 0,
+                0, 1, 0,  1, 1, 0,  1, 1, 1,  1, 1, 1,  0, 1, 1,  0, 1, 0
+        };
+        glGenVertexArrays(1, &proxyVAO);
+        glGenBuffers(1, &proxyVBO);
+        glState().bindVertexArray(proxyVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, proxyVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(cube), cube, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glState().bindVertexArray(0);
+    }
+};
+
+#endif //PROJECT_BASE_OCCLUSIONCULLER_H
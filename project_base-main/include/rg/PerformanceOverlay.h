@@ -0,0 +1,117 @@
+#ifndef PROJECT_BASE_PERFORMANCEOVERLAY_H
+#define PROJECT_BASE_PERFORMANCEOVERLAY_H
+
+#include <GLFW/glfw3.h>
+
+#include <imgui.h>
+#include <imgui_impl_glfw.h>
+#include <imgui_impl_opengl3.h>
+
+#include <rg/FramePacer.h>
+#include <rg/FrameTimes.h>
+#include <rg/GLStateCache.h>
+#include <rg/GpuProfiler.h>
+#include <rg/RenderStats.h>
+
+#include <algorithm>
+#include <vector>
+
+// ImGui window in the corner of the screen with the CPU frame times (time between presents) and
+// the GPU frame times of the last few seconds as graphs with their percentiles, what the last frame
+// asked of GL, and the rolling average GPU time and the draws of every pass the profiler saw in
+// the last frame, nested passes indented.
+// It takes no input, the cursor belongs to the camera.
+class PerformanceOverlay {
+public:
+    bool visible = false;
+
+    explicit PerformanceOverlay(GLFWwindow *window) {
+        IMGUI_CHECKVERSION();
+        ImGui::CreateContext();
+        ImGuiIO &io = ImGui::GetIO();
+        io.IniFilename = nullptr;
+        io.ConfigFlags |= ImGuiConfigFlags_NoMouse;
+        ImGui::StyleColorsDark();
+        // the callbacks stay the application's
+        ImGui_ImplGlfw_InitForOpenGL(window, false);
+        ImGui_ImplOpenGL3_Init("#version 330 core");
+    }
+
+    ~PerformanceOverlay() {
+        ImGui_ImplOpenGL3_Shutdown();
+        ImGui_ImplGlfw_Shutdown();
+        ImGui::DestroyContext();
+    }
+
+    PerformanceOverlay(const PerformanceOverlay &) = delete;
+    PerformanceOverlay &operator=(const PerformanceOverlay &) = delete;
+
+    // draws over whatever is bound, call after the scene is in the default framebuffer
+    void draw(const GpuProfiler &profiler, const RenderStats &stats, const FramePacer &framePacer, float renderScale) {
+        if (!visible)
+            return;
+        ImGui_ImplOpenGL3_NewFrame();
+        ImGui_ImplGlfw_NewFrame();
+        ImGui::NewFrame();
+
+        ImGui::SetNextWindowPos(ImVec2(10.0f, 10.0f));
+        ImGui::SetNextWindowBgAlpha(0.6f);
+        ImGui::Begin("performance", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize |
+                                             ImGuiWindowFlags_NoInputs | ImGuiWindowFlags_NoSavedSettings |
+                                             ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav);
+        frameGraph("CPU frame", framePacer.intervalHistory());
+        frameGraph("GPU frame", profiler.frameHistory());
+        ImGui::Text("render scale %.2f, %s", renderScale, FramePacer::modeName(framePacer.mode()));
+        const RenderStats::Counters &frame = stats.lastFrame();
+        ImGui::Text("%llu draws, %llu triangles, %llu vertices", frame.drawCalls, frame.triangles, frame.vertices);
+        ImGui::Text("%llu state changes (%llu texture binds, %llu programs)", frame.stateChanges, frame.textureBinds,
+                    frame.programSwitches);
+        ImGui::Text("%llu uniform calls, %.1f KB uploaded", frame.uniformUploads, frame.uploadedBytes / 1024.0);
+        ImGui::Separator();
+        for (const GpuProfiler::Pass &pass : profiler.passes()) {
+            if (!profiler.active(pass))
+                continue;
+            int indent = pass.depth * 2;
+            const RenderStats::Pass *counted = stats.lastFramePass(pass.name.c_str(), pass.depth);
+            ImGui::Text("%*s%-*s %6.3f ms %5llu draws %8llu tris", indent, "", 24 - indent, pass.name.c_str(),
+                        pass.average(), counted ? counted->counters.drawCalls : 0ull,
+                        counted ? counted->counters.triangles : 0ull);
+        }
+        ImGui::End();
+
+        ImGui::Render();
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        // ImGui binds its own program, buffers and textures behind the state cache
+        glState().invalidate();
+    }
+
+private:
+    std::vector<float> sorted;
+
+    // times in milliseconds, oldest first
+    void frameGraph(const char *label, const std::vector<float> &times) {
+        if (times.empty()) {
+            ImGui::Text("%s: waiting", label);
+            return;
+        }
+        sorted = times;
+        std::sort(sorted.begin(), sorted.end());
+        float sum = 0.0f;
+        for (float time : times)
+            sum += time;
+        ImGui::Text("%s %6.2f ms  p50 %.2f  p95 %.2f  p99 %.2f", label, sum / times.size(), percentile(0.50f),
+                    percentile(0.95f), percentile(0.99f));
+        // at least two 60 Hz frames tall, taller when the 99th percentile is; rarer spikes go off the top
+        ImGui::PushID(label);
+        ImGui::PlotLines("", times.data(), times.size(), 0, nullptr, 0.0f, std::max(33.3f, percentile(0.99f)),
+                         ImVec2(320.0f, 48.0f));
+        ImGui::PopID();
+    }
+
+    // of the times last given to frameGraph()
+    float percentile(float p) const {
+        return FrameTimes::percentile(sorted, p);
+    }
+};
+
+#endif //PROJECT_BASE_PERFORMANCEOVERLAY_H
@@ -0,0 +1,158 @@
+#ifndef PROJECT_BASE_PROGRAMBINARYCACHE_H
+#define PROJECT_BASE_PROGRAMBINARYCACHE_H
+
+#include <glad/glad.h>
+
+#include <rg/GLExtensions.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+// Keeps linked programs on disk with glGetProgramBinary so later launches can skip compiling.
+// A program is stored under a hash of its sources (defines included) and the GL vendor, renderer
+// and version, so editing a shader or switching drivers simply misses. Binaries the driver refuses
+// are deleted and the program is compiled from source again, callers only see a slower startup.
+// Every entry remembers how long compiling it took, which is what a hit saves.
+class ProgramBinaryCache {
+public:
+    // cleared by --no-shader-cache, must be set before the first Shader is created
+    bool enabled = true;
+    std::string directory = "shader_cache";
+
+    unsigned int hits = 0;
+    unsigned int misses = 0;
+    double compileMilliseconds = 0.0;
+    double loadMilliseconds = 0.0;
+    // compile time the hits would have taken, minus loading them
+    double savedMilliseconds = 0.0;
+
+    bool available() const {
+        return enabled && glExtensions().programBinary;
+    }
+
+    // key of a program built from the given (already preprocessed) stage sources
+    static std::string key(const std::vector<std::string> &sources) {
+        std::uint64_t hash = 14695981039346656037ull;
+        auto add = [&hash](const std::string &text) {
+            for (unsigned char c : text) {
+                hash ^= c;
+                hash *= 1099511628211ull;
+            }
+            // separator, so moving text between two strings changes the hash
+            hash ^= 0xFF;
+            hash *= 1099511628211ull;
+        };
+        for (const std::string &source : sources)
+            add(source);
+        for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+            const GLubyte *value = glGetString(name);
+            add(value ? (const char *) value : "");
+        }
+        char hex[17];
+        std::snprintf(hex, sizeof(hex), "%016llx", (unsigned long long) hash);
+        return hex;
+    }
+
+    // makes the program's binary retrievable, call before linking it
+    void prepare(GLuint program) const {
+        if (available())
+            glExtensions().ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // loads the cached binary into program, false if there is none or the driver refused it;
+    // time it and report with loaded()
+    bool load(GLuint program, const std::string &key) {
+        if (!available())
+            return false;
+        std::ifstream file(path(key), std::ios::binary);
+        Header header;
+        if (!file.read((char *) &header, sizeof(header)) || header.magic != MAGIC || header.length <= 0) {
+            misses++;
+            return false;
+        }
+        std::vector<char> binary(header.length);
+        if (!file.read(binary.data(), binary.size())) {
+            misses++;
+            return false;
+        }
+        file.close();
+
+        glExtensions().ProgramBinary(program, header.format, binary.data(), binary.size());
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            // usually a driver update that kept the version string, forget the entry
+            std::remove(path(key).c_str());
+            misses++;
+            return false;
+        }
+        hits++;
+        savedMilliseconds += header.compileMilliseconds;
+        return true;
+    }
+
+    // finishes timing a hit: what loading took comes off what it saved
+    void loaded(double milliseconds) {
+        loadMilliseconds += milliseconds;
+        savedMilliseconds -= milliseconds;
+    }
+
+    // writes the binary of a freshly linked program
+    void store(GLuint program, const std::string &key, double milliseconds) {
+        compileMilliseconds += milliseconds;
+        if (!available())
+            return;
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+        Header header;
+        header.magic = MAGIC;
+        header.length = length;
+        header.compileMilliseconds = milliseconds;
+        std::vector<char> binary(length);
+        glExtensions().GetProgramBinary(program, length, nullptr, &header.format, binary.data());
+
+        mkdir(directory.c_str(), 0755);
+        std::ofstream file(path(key), std::ios::binary | std::ios::trunc);
+        file.write((const char *) &header, sizeof(header));
+        file.write(binary.data(), binary.size());
+        if (!file)
+            std::cout << "ERROR::SHADER::PROGRAM_BINARY_NOT_WRITTEN: " << path(key) << std::endl;
+    }
+
+    void printStats() const {
+        if (!available()) {
+            std::cout << "shader cache: off, compiled in " << compileMilliseconds << " ms" << std::endl;
+            return;
+        }
+        std::cout << "shader cache: " << hits << " loaded in " << loadMilliseconds << " ms, " << misses
+                  << " compiled in " << compileMilliseconds << " ms, " << savedMilliseconds << " ms saved" << std::endl;
+    }
+
+private:
+    static const std::uint32_t MAGIC = 0x42505247; // "GRPB"
+
+    struct Header {
+        std::uint32_t magic = 0;
+        GLenum format = 0;
+        GLint length = 0;
+        double compileMilliseconds = 0.0;
+    };
+
+    std::string path(const std::string &key) const {
+        return directory + "/" + key + ".bin";
+    }
+};
+
+ProgramBinaryCache &programBinaryCache() {
+    static ProgramBinaryCache cache;
+    return cache;
+}
+
+#endif //PROJECT_BASE_PROGRAMBINARYCACHE_H
@@ -0,0 +1,138 @@
+#ifndef PROJECT_BASE_RENDERQUEUE_H
+#define PROJECT_BASE_RENDERQUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/shader.h>
+#include <rg/CpuProfiler.h>
+#include <rg/GLStateCache.h>
+#include <rg/RenderStats.h>
+#include <rg/ShaderVariants.h>
+#include <rg/ThreadPool.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// One recorded draw: plain values and handles, recording one makes no GL call, so any thread can.
+struct DrawCommand {
+    // order of submission, see RenderQueue::sortKey
+    std::uint64_t key;
+    Material *material;
+    unsigned int vertexArray;
+    unsigned int indexCount;
+    glm::mat4 transform;
+};
+
+// Linear list of commands one job records. clear() keeps the memory, so once a buffer has seen
+// its largest frame recording into it allocates nothing.
+class CommandBuffer {
+public:
+    void clear() {
+        commands.clear();
+    }
+
+    void draw(std::uint64_t key, Material &material, unsigned int vertexArray, unsigned int indexCount,
+              const glm::mat4 &transform) {
+        commands.push_back(DrawCommand{key, &material, vertexArray, indexCount, transform});
+    }
+
+    const std::vector<DrawCommand> &list() const {
+        return commands;
+    }
+
+private:
+    std::vector<DrawCommand> commands;
+};
+
+// Records the draws of a frame on the thread pool and replays them on the GL thread. The scene is
+// split into partitions that record into their own CommandBuffer in parallel, so culling, matrix
+// math and key building scale with the cores; the GL thread then sorts the commands of all
+// buffers by key and issues them, changing the shader variant, textures and vertex array only
+// where the key says they differ.
+class RenderQueue {
+public:
+    explicit RenderQueue(ThreadPool &pool) : pool(pool) {
+    }
+
+    RenderQueue(const RenderQueue &) = delete;
+    RenderQueue &operator=(const RenderQueue &) = delete;
+
+    // shader variant features first, then material, then front to back, which is what the state
+    // changes and early depth rejection care about, in that order
+    static std::uint64_t sortKey(unsigned int features, unsigned int material, float distance) {
+        const float DEPTH_STEPS_PER_UNIT = 16.0f;
+        const std::uint64_t MAX_DEPTH = (1u << 24) - 1;
+        std::uint64_t depth = distance <= 0.0f ? 0 : std::min((std::uint64_t) (distance * DEPTH_STEPS_PER_UNIT), MAX_DEPTH);
+        return ((std::uint64_t) features << 56) | ((std::uint64_t) (material & 0xFFFFFFu) << 24) | depth;
+    }
+
+    // calls record(partition, buffer) for each of partitions on the pool, every partition with its
+    // own empty buffer, then sorts what they recorded; replaces the commands of the last record()
+    template <typename Record>
+    void record(unsigned int partitions, Record record) {
+        if (buffers.size() < partitions)
+            buffers.resize(partitions);
+        for (CommandBuffer &buffer : buffers)
+            buffer.clear();
+        pool.parallelFor(partitions, [this, &record](unsigned int partition) {
+            PROFILE_SCOPE("record partition");
+            record(partition, buffers[partition]);
+        });
+
+        PROFILE_SCOPE("sort commands");
+        order.clear();
+        for (unsigned int b = 0; b < partitions; b++)
+            for (const DrawCommand &command : buffers[b].list())
+                order.push_back(&command);
+        // ties keep partition order, so a frame replays the same way whichever thread ran what
+        std::stable_sort(order.begin(), order.end(), [](const DrawCommand *a, const DrawCommand *b) {
+            return a->key < b->key;
+        });
+    }
+
+    // issues the recorded commands, each with the variant of features plus what its material needs
+    void submit(ShaderVariants &variants, unsigned int features) {
+        Shader *shader = nullptr;
+        GLint modelLocation = -1;
+        for (const DrawCommand *command : order) {
+            Shader &variant = variants.get(features | command->material->features());
+            if (&variant != shader) {
+                shader = &variant;
+                shader->use();
+                modelLocation = shader->uniformLocation("model"_uniform);
+            }
+            command->material->bind(*shader);
+            shader->setMat4(modelLocation, command->transform);
+            issue(*command);
+        }
+    }
+
+    // issues the recorded commands without textures with depthShader
+    void submitDepth(Shader &depthShader) {
+        depthShader.use();
+        GLint modelLocation = depthShader.uniformLocation("model"_uniform);
+        for (const DrawCommand *command : order) {
+            depthShader.setMat4(modelLocation, command->transform);
+            issue(*command);
+        }
+    }
+
+    unsigned int commandCount() const {
+        return order.size();
+    }
+
+private:
+    ThreadPool &pool;
+    std::vector<CommandBuffer> buffers;
+    std::vector<const DrawCommand *> order;
+
+    static void issue(const DrawCommand &command) {
+        glState().bindVertexArray(command.vertexArray);
+        renderStats().drawElements(GL_TRIANGLES, command.indexCount, GL_UNSIGNED_INT, 0);
+    }
+};
+
+#endif //PROJECT_BASE_RENDERQUEUE_H
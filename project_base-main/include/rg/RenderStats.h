@@ -0,0 +1,205 @@
+#ifndef PROJECT_BASE_RENDERSTATS_H
+#define PROJECT_BASE_RENDERSTATS_H
+
+#include <glad/glad.h>
+
+#include <rg/GLExtensions.h>
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Counts what a frame asks of GL: draw calls with the triangles and vertices they submit, state
+// changes that reached GL (of which texture binds and program switches), glUniform calls and bytes
+// uploaded into buffers and textures. The draws go through the wrappers below, the rest is
+// reported by the state cache, the shaders and the code that uploads.
+// Counts go to the frame and to every pass open at the time, so a pass includes the ones nested
+// in it. The last finished frame can be read back and every frame written to a CSV file, one row
+// for the frame and one per pass.
+class RenderStats {
+public:
+    struct Counters {
+        unsigned long long drawCalls = 0;
+        unsigned long long triangles = 0;
+        unsigned long long vertices = 0;
+        unsigned long long stateChanges = 0;
+        unsigned long long textureBinds = 0;
+        unsigned long long programSwitches = 0;
+        unsigned long long uniformUploads = 0;
+        unsigned long long uploadedBytes = 0;
+    };
+
+    struct Pass {
+        // must outlive the stats, passes are told apart by name and nesting depth
+        const char *name;
+        unsigned int depth;
+        Counters counters;
+    };
+
+    // call once per frame, moves the counts into lastFrame() and logs them
+    void beginFrame() {
+        if (frames > 0 && log)
+            writeFrame();
+        lastCounters = counters;
+        lastPasses.swap(passes);
+        counters = Counters();
+        passes.clear();
+        open.clear();
+        frames++;
+    }
+
+    void beginPass(const char *name) {
+        unsigned int depth = open.size();
+        for (unsigned int i = 0; i < passes.size(); i++) {
+            // a pass begun twice in a frame counts as one
+            if (passes[i].depth == depth && std::strcmp(passes[i].name, name) == 0) {
+                open.push_back(i);
+                return;
+            }
+        }
+        passes.push_back(Pass{name, depth, Counters()});
+        open.push_back(passes.size() - 1);
+    }
+
+    // ends the innermost pass begun and not yet ended
+    void endPass() {
+        if (!open.empty())
+            open.pop_back();
+    }
+
+    void drawArrays(GLenum mode, GLint first, GLsizei count) {
+        glDrawArrays(mode, first, count);
+        draw(mode, count, 1);
+    }
+
+    void drawElements(GLenum mode, GLsizei count, GLenum type, const void *indices) {
+        glDrawElements(mode, count, type, indices);
+        draw(mode, count, 1);
+    }
+
+    void drawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instances) {
+        glDrawElementsInstanced(mode, count, type, indices, instances);
+        draw(mode, count, instances);
+    }
+
+    // the index counts of the commands are in the indirect buffer, indexCount is their sum
+    void multiDrawElementsIndirect(GLenum mode, GLenum type, const void *indirect, GLsizei drawCount, GLsizei stride,
+                                   unsigned long long indexCount) {
+        glExtensions().MultiDrawElementsIndirect(mode, type, indirect, drawCount, stride);
+        add(&Counters::drawCalls, 1);
+        add(&Counters::vertices, indexCount);
+        add(&Counters::triangles, triangles(mode, indexCount));
+    }
+
+    void stateChange() {
+        add(&Counters::stateChanges, 1);
+    }
+
+    void textureBind() {
+        add(&Counters::textureBinds, 1);
+    }
+
+    void programSwitch() {
+        add(&Counters::programSwitches, 1);
+    }
+
+    void uniformUpload(unsigned long long bytes) {
+        add(&Counters::uniformUploads, 1);
+        add(&Counters::uploadedBytes, bytes);
+    }
+
+    void bufferUpload(unsigned long long bytes) {
+        add(&Counters::uploadedBytes, bytes);
+    }
+
+    const Counters &lastFrame() const {
+        return lastCounters;
+    }
+
+    // passes of the last finished frame in the order they were first begun
+    const std::vector<Pass> &lastFramePasses() const {
+        return lastPasses;
+    }
+
+    // the pass called name at depth in the last finished frame, null if it wasn't drawn
+    const Pass *lastFramePass(const char *name, unsigned int depth) const {
+        for (const Pass &pass : lastPasses)
+            if (pass.depth == depth && std::strcmp(pass.name, name) == 0)
+                return &pass;
+        return nullptr;
+    }
+
+    // writes the counts of every frame from now on, depth 0 is the whole frame
+    bool logFrames(const std::string &path) {
+        log.open(path);
+        if (!log) {
+            std::cout << "ERROR::RENDER_STATS::CANNOT_OPEN_LOG: " << path << std::endl;
+            return false;
+        }
+        log << "frame,pass,depth,draw_calls,triangles,vertices,state_changes,texture_binds,program_switches,"
+               "uniform_uploads,uploaded_bytes\n";
+        return true;
+    }
+
+    void printLastFrame() const {
+        std::cout << "render stats: " << lastCounters.drawCalls << " draws, " << lastCounters.triangles
+                  << " triangles, " << lastCounters.stateChanges << " state changes (" << lastCounters.textureBinds
+                  << " texture binds, " << lastCounters.programSwitches << " program switches), "
+                  << lastCounters.uniformUploads << " uniform uploads, " << lastCounters.uploadedBytes
+                  << " bytes uploaded" << std::endl;
+    }
+
+private:
+    Counters counters, lastCounters;
+    std::vector<Pass> passes, lastPasses;
+    std::vector<unsigned int> open;
+    unsigned long long frames = 0;
+    std::ofstream log;
+
+    void add(unsigned long long Counters::*counter, unsigned long long amount) {
+        counters.*counter += amount;
+        for (unsigned int pass : open)
+            passes[pass].counters.*counter += amount;
+    }
+
+    void draw(GLenum mode, GLsizei count, GLsizei instances) {
+        unsigned long long vertices = (unsigned long long) count * instances;
+        add(&Counters::drawCalls, 1);
+        add(&Counters::vertices, vertices);
+        add(&Counters::triangles, triangles(mode, count) * instances);
+    }
+
+    static unsigned long long triangles(GLenum mode, unsigned long long vertices) {
+        switch (mode) {
+            case GL_TRIANGLES: return vertices / 3;
+            case GL_TRIANGLE_STRIP:
+            case GL_TRIANGLE_FAN: return vertices >= 3 ? vertices - 2 : 0;
+            default: return 0;
+        }
+    }
+
+    // the frame being finished, its passes are still in passes
+    void writeFrame() {
+        writeRow("frame", 0, counters);
+        for (const Pass &pass : passes)
+            writeRow(pass.name, pass.depth + 1, pass.counters);
+    }
+
+    void writeRow(const char *name, unsigned int depth, const Counters &c) {
+        log << frames << ",\"";
+        for (const char *n = name; *n; n++)
+            log << (*n == '"' ? "\"\"" : std::string(1, *n));
+        log << "\"," << depth << ',' << c.drawCalls << ',' << c.triangles << ',' << c.vertices << ','
+            << c.stateChanges << ',' << c.textureBinds << ',' << c.programSwitches << ',' << c.uniformUploads << ','
+            << c.uploadedBytes << '\n';
+    }
+};
+
+RenderStats &renderStats() {
+    static RenderStats stats;
+    return stats;
+}
+
+#endif //PROJECT_BASE_RENDERSTATS_H
@@ -0,0 +1,121 @@
+#ifndef PROJECT_BASE_SCENETARGET_H
+#define PROJECT_BASE_SCENETARGET_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+#include <rg/GLStateCache.h>
+#include <rg/RenderStats.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// Offscreen colour and depth the scene is drawn into at a lower resolution, then stretched over
+// the window. The target is as big as the window and a frame only uses its lower left corner,
+// so changing the render size every few frames allocates nothing. The upscale is bilinear, with
+// a light sharpening that works against the blur when the render size is under the window's.
+// Depth is GL_DEPTH24_STENCIL8 like the default framebuffer's, so the G-buffer can still be
+// blitted into it.
+class SceneTarget {
+public:
+    // how much the upscale sharpens once the scene is drawn smaller than the window
+    static constexpr float SHARPNESS = 0.4f;
+
+    // upscaleShader draws the fullscreen triangle of deferred_directional.vs with upscale.fs
+    explicit SceneTarget(Shader &upscaleShader) : upscaleShader(upscaleShader) {
+        upscaleShader.use();
+        upscaleShader.setInt("scene", 0);
+        glGenVertexArrays(1, &fullscreenVAO);
+    }
+
+    ~SceneTarget() {
+        release();
+        glDeleteVertexArrays(1, &fullscreenVAO);
+    }
+
+    SceneTarget(const SceneTarget &) = delete;
+    SceneTarget &operator=(const SceneTarget &) = delete;
+
+    // binds the target for a frame drawn at scale of a window of windowWidth x windowHeight, sets
+    // the viewport to the part it covers and returns that size
+    glm::ivec2 begin(int windowWidth, int windowHeight, float scale) {
+        resize(windowWidth, windowHeight);
+        renderSize = glm::ivec2(std::max((int) std::lround(windowWidth * scale), 1),
+                                std::max((int) std::lround(windowHeight * scale), 1));
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glState().viewport(0, 0, renderSize.x, renderSize.y);
+        return renderSize;
+    }
+
+    unsigned int ID() const {
+        return framebuffer;
+    }
+
+    // draws what begin() rendered over the whole of output, a window sized framebuffer
+    void upscale(unsigned int output = 0) {
+        glBindFramebuffer(GL_FRAMEBUFFER, output);
+        glState().viewport(0, 0, width, height);
+        glState().setEnabled(GL_DEPTH_TEST, false);
+        glState().depthMask(false);
+        upscaleShader.use();
+        upscaleShader.setVec2("renderSize"_uniform, glm::vec2(renderSize));
+        upscaleShader.setVec2("outputSize"_uniform, glm::vec2(width, height));
+        upscaleShader.setFloat("sharpness"_uniform, renderSize.x < width ? SHARPNESS : 0.0f);
+        glState().bindTexture(0, GL_TEXTURE_2D, color);
+        glState().bindVertexArray(fullscreenVAO);
+        renderStats().drawArrays(GL_TRIANGLES, 0, 3);
+        glState().depthMask(true);
+        glState().setEnabled(GL_DEPTH_TEST, true);
+    }
+
+private:
+    Shader &upscaleShader;
+    int width = 0, height = 0;
+    glm::ivec2 renderSize = glm::ivec2(0);
+    unsigned int framebuffer = 0, color = 0, depth = 0;
+    unsigned int fullscreenVAO = 0;
+
+    // (re)creates the attachments when the window size changed
+    void resize(int newWidth, int newHeight) {
+        if (newWidth == width && newHeight == height)
+            return;
+        release();
+        width = newWidth;
+        height = newHeight;
+
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glGenTextures(1, &color);
+        glState().bindTexture(0, GL_TEXTURE_2D, color);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+        glGenRenderbuffers(1, &depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::SCENE_TARGET::FRAMEBUFFER_INCOMPLETE" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void release() {
+        if (!framebuffer)
+            return;
+        glDeleteTextures(1, &color);
+        glDeleteRenderbuffers(1, &depth);
+        glDeleteFramebuffers(1, &framebuffer);
+        // deleted names can come back from glGenTextures, the cache must not think they are bound
+        glState().invalidate();
+        framebuffer = color = depth = 0;
+    }
+};
+
+constexpr float SceneTarget::SHARPNESS;
+
+#endif //PROJECT_BASE_SCENETARGET_H
@@ -0,0 +1,95 @@
+#ifndef PROJECT_BASE_SHADERMANAGER_H
+#define PROJECT_BASE_SHADERMANAGER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/shader.h>
+#include <rg/GLStateCache.h>
+#include <rg/RenderStats.h>
+#include <rg/ShaderVariants.h>
+
+#include <chrono>
+#include <initializer_list>
+#include <iostream>
+#include <vector>
+
+// Drives the compilation of every shader variant set of the scene. submitAll() queues all compile
+// and link jobs before anything waits on one, so the driver can run them in parallel (with
+// KHR_parallel_shader_compile on its own threads) while the models load. warmUp() then waits for
+// whatever is left and draws every variant once into a small offscreen framebuffer, so the work
+// drivers defer to a program's first draw doesn't land in the first visible frames.
+class ShaderManager {
+public:
+    ShaderManager(std::initializer_list<ShaderVariants *> sets) : sets(sets) {
+    }
+
+    void submitAll() {
+        for (ShaderVariants *variants : sets)
+            variants->submitAll();
+    }
+
+    unsigned int pendingCount() const {
+        unsigned int count = 0;
+        for (ShaderVariants *variants : sets)
+            count += variants->pendingCount();
+        return count;
+    }
+
+    // call once before the first frame, with the scene's uniform buffers already bound
+    void warmUp() {
+        auto start = std::chrono::steady_clock::now();
+        unsigned int pending = pendingCount();
+        for (ShaderVariants *variants : sets)
+            variants->waitAll();
+
+        unsigned int framebuffer, textures[2], depth;
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glGenTextures(2, textures);
+        for (unsigned int i = 0; i < 2; i++) {
+            glState().bindTexture(0, GL_TEXTURE_2D, textures[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, WARM_UP_SIZE, WARM_UP_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, textures[i], 0);
+        }
+        glGenRenderbuffers(1, &depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, WARM_UP_SIZE, WARM_UP_SIZE);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth);
+        GLenum attachments[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+        glDrawBuffers(2, attachments);
+
+        // no attributes are enabled, every vertex reads the current attribute values
+        unsigned int vao;
+        glGenVertexArrays(1, &vao);
+        glState().bindVertexArray(vao);
+        unsigned int drawn = 0;
+        for (ShaderVariants *variants : sets) {
+            variants->forEachReady([&drawn](Shader &shader) {
+                shader.use();
+                renderStats().drawArrays(GL_TRIANGLES, 0, 3);
+                drawn++;
+            });
+        }
+        glFinish();
+
+        glState().bindVertexArray(0);
+        glDeleteVertexArrays(1, &vao);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteRenderbuffers(1, &depth);
+        glDeleteTextures(2, textures);
+        glDeleteFramebuffers(1, &framebuffer);
+        // deleted names can come back from glGen*, the cache must not think they are bound
+        glState().invalidate();
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "shader warm-up: " << drawn << " variants drawn, " << pending << " still compiling before, "
+                  << elapsed.count() << " ms" << std::endl;
+    }
+
+private:
+    static const int WARM_UP_SIZE = 4;
+
+    std::vector<ShaderVariants *> sets;
+};
+
+#endif //PROJECT_BASE_SHADERMANAGER_H
@@ -0,0 +1,157 @@
+#ifndef PROJECT_BASE_SHADERVARIANTS_H
+#define PROJECT_BASE_SHADERVARIANTS_H
+
+#include <learnopengl/shader.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Permutations of one vertex + fragment shader pair, compiled with a #define per feature bit.
+// A variant is picked by the features the material and render state need, so a mesh without a
+// specular map or a quad without parallax doesn't pay for them. Features the source doesn't react
+// to are masked off so they can't produce duplicate programs.
+// Variants are compiled asynchronously: submitAll() hands every compile to the driver at once, and
+// a variant asked for before its link completed is replaced by the fallback program, the same
+// vertex shader with a flat grey fragment shader, instead of stalling the frame.
+class ShaderVariants {
+public:
+    static const unsigned int HAS_SPECULAR_MAP = 1u << 0;
+    static const unsigned int ALPHA_TEST = 1u << 1;
+    static const unsigned int PARALLAX = 1u << 2;
+    static const unsigned int NUM_FEATURES = 3;
+    static constexpr const char *FALLBACK_FRAGMENT_PATH = "resources/shaders/fallback.fs";
+
+    // called once on every variant when its link is done and on the fallback, to bind the uniform
+    // blocks and set the constant uniforms
+    using Setup = std::function<void(Shader &)>;
+
+    ShaderVariants(const std::string &vertexPath, const std::string &fragmentPath, unsigned int supportedFeatures,
+                   Setup setup = Setup())
+            : vertexPath(vertexPath), fragmentPath(fragmentPath), supportedFeatures(supportedFeatures),
+              setup(setup), variants(1u << NUM_FEATURES) {
+    }
+
+    ShaderVariants(const ShaderVariants &) = delete;
+    ShaderVariants &operator=(const ShaderVariants &) = delete;
+
+    // the variant for features, or the fallback while it is still being compiled
+    Shader &get(unsigned int features) {
+        features &= supportedFeatures;
+        std::unique_ptr<Shader> &variant = variants[features];
+        if (!variant)
+            submit(features);
+        if (variant->isLinking()) {
+            if (!variant->linkCompleted())
+                return fallback();
+            finish(*variant);
+        }
+        return *variant;
+    }
+
+    // starts compiling every variant that wasn't asked for yet
+    void submitAll() {
+        for (unsigned int features = 0; features < variants.size(); features++)
+            if ((features & supportedFeatures) == features && !variants[features])
+                submit(features);
+    }
+
+    // blocks until every submitted variant is linked
+    void waitAll() {
+        for (std::unique_ptr<Shader> &variant : variants)
+            if (variant && variant->isLinking())
+                finish(*variant);
+    }
+
+    // variants still compiling
+    unsigned int pendingCount() const {
+        unsigned int count = 0;
+        for (const std::unique_ptr<Shader> &variant : variants)
+            count += variant && variant->isLinking();
+        return count;
+    }
+
+    // calls fn on every variant whose link is done
+    template <typename Function>
+    void forEachReady(Function fn) {
+        for (std::unique_ptr<Shader> &variant : variants)
+            if (variant && !variant->isLinking())
+                fn(*variant);
+    }
+
+    // the files every variant and the fallback are built from
+    std::vector<std::string> files() const {
+        return {vertexPath, fragmentPath, FALLBACK_FRAGMENT_PATH};
+    }
+
+    // builds every variant made from path again, setup runs on the ones that took the new version;
+    // returns how many did, a variant that doesn't link keeps its current program
+    unsigned int reload(const std::string &path, unsigned int *failed = nullptr) {
+        unsigned int reloaded = 0;
+        auto reloadShader = [&](Shader &shader) {
+            if (!shader.usesFile(path))
+                return;
+            if (shader.isLinking())
+                finish(shader);
+            if (shader.reload()) {
+                if (setup)
+                    setup(shader);
+                reloaded++;
+            } else if (failed) {
+                (*failed)++;
+            }
+        };
+        for (std::unique_ptr<Shader> &variant : variants)
+            if (variant)
+                reloadShader(*variant);
+        if (fallbackShader)
+            reloadShader(*fallbackShader);
+        return reloaded;
+    }
+
+    static std::vector<std::string> defines(unsigned int features) {
+        static const char *names[NUM_FEATURES] = {"HAS_SPECULAR_MAP", "ALPHA_TEST", "PARALLAX"};
+        std::vector<std::string> result;
+        for (unsigned int bit = 0; bit < NUM_FEATURES; bit++)
+            if (features & (1u << bit))
+                result.push_back(names[bit]);
+        return result;
+    }
+
+private:
+    std::string vertexPath;
+    std::string fragmentPath;
+    unsigned int supportedFeatures;
+    Setup setup;
+    std::vector<std::unique_ptr<Shader>> variants;
+    std::unique_ptr<Shader> fallbackShader;
+
+    void submit(unsigned int features) {
+        variants[features] = std::make_unique<Shader>(vertexPath.c_str(), fragmentPath.c_str(), defines(features),
+                                                      nullptr, false);
+        // loaded from the program binary cache, nothing to wait for
+        if (!variants[features]->isLinking() && setup)
+            setup(*variants[features]);
+    }
+
+    void finish(Shader &variant) {
+        variant.finishLink();
+        if (setup)
+            setup(variant);
+    }
+
+    // tiny, compiled right away the first time a variant isn't ready
+    Shader &fallback() {
+        if (!fallbackShader) {
+            fallbackShader = std::make_unique<Shader>(vertexPath.c_str(), FALLBACK_FRAGMENT_PATH);
+            if (setup)
+                setup(*fallbackShader);
+        }
+        return *fallbackShader;
+    }
+};
+
+constexpr const char *ShaderVariants::FALLBACK_FRAGMENT_PATH;
+
+#endif //PROJECT_BASE_SHADERVARIANTS_H
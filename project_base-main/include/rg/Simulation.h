@@ -0,0 +1,173 @@
+#ifndef PROJECT_BASE_SIMULATION_H
+#define PROJECT_BASE_SIMULATION_H
+
+#include <glm/glm.hpp>
+
+#include <rg/CpuProfiler.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Input handed from the thread that polls the window to the simulation. GLFW calls its callbacks
+// on that thread, they record what happened here and the simulation consumes it on its next tick.
+// Held actions are bits of a mask the application defines.
+class SimulationInput {
+public:
+    void press(unsigned int actions) {
+        held.fetch_or(actions);
+    }
+
+    void release(unsigned int actions) {
+        held.fetch_and(~actions);
+    }
+
+    unsigned int heldActions() const {
+        return held.load();
+    }
+
+    void moveMouse(float xoffset, float yoffset) {
+        std::lock_guard<std::mutex> lock(mutex);
+        mouseMotion += glm::vec2(xoffset, yoffset);
+    }
+
+    void scroll(float yoffset) {
+        std::lock_guard<std::mutex> lock(mutex);
+        scrollMotion += yoffset;
+    }
+
+    // mouse movement and scrolling since the last call
+    void takeMotion(glm::vec2 &mouse, float &scrolled) {
+        std::lock_guard<std::mutex> lock(mutex);
+        mouse = mouseMotion;
+        scrolled = scrollMotion;
+        mouseMotion = glm::vec2(0.0f);
+        scrollMotion = 0.0f;
+    }
+
+private:
+    std::atomic<unsigned int> held{0};
+    std::mutex mutex;
+    glm::vec2 mouseMotion = glm::vec2(0.0f);
+    float scrollMotion = 0.0f;
+};
+
+// Runs tick(step) on its own thread at a fixed rate, independent of how long frames take, and
+// after every tick publishes capture() of the state the ticks advance. The state belongs to the
+// simulation thread while it runs, the renderer only sees the snapshots.
+// Snapshots go through three slots without locks: the simulation fills the one it holds and swaps
+// it with the shared one, the renderer swaps its own with the shared one when that holds something
+// newer, so neither ever waits for the other or sees a half written frame. A frame carries the
+// snapshots of the last two ticks, latest() says how far the render time is between them.
+template <typename Snapshot>
+class Simulation {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Frame {
+        Snapshot previous;
+        Snapshot current;
+        // when the tick that produced current was due
+        Clock::time_point time;
+        unsigned long long tick = 0;
+    };
+
+    Simulation(double tickRate, std::function<void(float)> tick, std::function<Snapshot()> capture)
+            : step(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / tickRate))),
+              tick(std::move(tick)), capture(std::move(capture)) {
+    }
+
+    ~Simulation() {
+        stop();
+    }
+
+    Simulation(const Simulation &) = delete;
+    Simulation &operator=(const Simulation &) = delete;
+
+    // seconds one tick advances the state by
+    float stepSeconds() const {
+        return std::chrono::duration<float>(step).count();
+    }
+
+    // the caller must not touch the simulated state until stop()
+    void start() {
+        if (running)
+            return;
+        Frame frame;
+        frame.previous = frame.current = capture();
+        frame.time = Clock::now();
+        for (Frame &slot : slots)
+            slot = frame;
+        running = true;
+        thread = std::thread([this, frame]() { run(frame); });
+    }
+
+    void stop() {
+        if (!running)
+            return;
+        running = false;
+        thread.join();
+    }
+
+    // the newest published frame; alpha is how far now lies between the times of its two
+    // snapshots, rendering one tick behind so there is always a next snapshot to move towards
+    const Frame &latest(float &alpha) {
+        if (shared.load(std::memory_order_acquire) & FRESH)
+            front = shared.exchange(front, std::memory_order_acq_rel) & INDEX;
+        const Frame &frame = slots[front];
+        alpha = std::chrono::duration<float>(Clock::now() - frame.time).count() / stepSeconds();
+        alpha = std::min(std::max(alpha, 0.0f), 1.0f);
+        return frame;
+    }
+
+    // ticks skipped after the thread fell too far behind, see MAX_CATCH_UP_TICKS
+    unsigned long long droppedTicks() const {
+        return dropped.load();
+    }
+
+private:
+    static const unsigned int INDEX = 3, FRESH = 4;
+    // falling further behind than this (a debugger break, a suspended machine) skips the ticks
+    // instead of running them all at once
+    static const unsigned int MAX_CATCH_UP_TICKS = 10;
+
+    Clock::duration step;
+    std::function<void(float)> tick;
+    std::function<Snapshot()> capture;
+    std::thread thread;
+    std::atomic<bool> running{false};
+    std::atomic<unsigned long long> dropped{0};
+
+    Frame slots[3];
+    // back belongs to the simulation thread, front to the renderer, shared to neither
+    unsigned int back = 0, front = 1;
+    std::atomic<unsigned int> shared{2};
+
+    void run(Frame frame) {
+        cpuProfiler().nameThread("simulation");
+        float seconds = stepSeconds();
+        while (running) {
+            frame.time += step;
+            std::this_thread::sleep_until(frame.time);
+            Clock::time_point now = Clock::now();
+            if (now - frame.time > step * MAX_CATCH_UP_TICKS) {
+                dropped += (now - frame.time) / step;
+                frame.time = now;
+            }
+
+            PROFILE_SCOPE("simulation tick");
+            tick(seconds);
+            frame.previous = frame.current;
+            frame.current = capture();
+            frame.tick++;
+
+            slots[back] = frame;
+            back = shared.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+        }
+    }
+};
+
+#endif //PROJECT_BASE_SIMULATION_H
@@ -0,0 +1,247 @@
+#ifndef PROJECT_BASE_STATICBATCHES_H
+#define PROJECT_BASE_STATICBATCHES_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/model.h>
+#include <learnopengl/shader.h>
+#include <rg/CpuProfiler.h>
+#include <rg/Frustum.h>
+#include <rg/GLStateCache.h>
+#include <rg/RenderStats.h>
+#include <rg/ShaderVariants.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <utility>
+#include <vector>
+
+// Merges the meshes of props that never move into world space geometry, built once at startup.
+// Every mesh instance is transformed by its model matrix and appended to the batch of its material
+// in the CELL_SIZE grid cell holding the centre of its bounds, so a batch is one draw with one set
+// of textures and an identity model matrix, and cells the camera can't see are skipped with a
+// frustum test on the batch bounds. All batches live in one vertex and one index buffer.
+class StaticBatches {
+public:
+    // edge of a grid cell in world units, about the size of the ship deck or the cabin
+    static constexpr float CELL_SIZE = 32.0f;
+
+    StaticBatches() = default;
+
+    ~StaticBatches() {
+        releaseBuffers();
+    }
+
+    StaticBatches(const StaticBatches &) = delete;
+    StaticBatches &operator=(const StaticBatches &) = delete;
+
+    // the instance is baked with this transform, call build() after the last one
+    void add(Model &model, const glm::mat4 &transform) {
+        instances.push_back(Instance{&model, transform});
+    }
+
+    bool contains(const Model &model) const {
+        for (const Instance &instance : instances)
+            if (instance.model == &model)
+                return true;
+        return false;
+    }
+
+    // transforms and merges every added instance into the batches and uploads them; calling it
+    // again after a model was imported again replaces the old batches
+    void build() {
+        releaseBuffers();
+        batches.clear();
+
+        // (cell, textures) -> geometry of the batch, in world space
+        typedef std::pair<std::array<int, 3>, std::array<unsigned int, Material::NUM_UNITS>> Key;
+        struct Bucket {
+            Material material;
+            std::vector<Vertex> vertices;
+            std::vector<unsigned int> indices;
+            glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+            glm::vec3 boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+        };
+        std::map<Key, Bucket> buckets;
+        std::vector<Vertex> transformed;
+        for (const Instance &instance : instances) {
+            glm::mat3 linear = glm::mat3(instance.transform);
+            glm::mat3 normalMatrix = glm::transpose(glm::inverse(linear));
+            // a mirroring transform turns the triangles around, swap two corners to keep them front facing
+            bool mirrored = glm::determinant(linear) < 0.0f;
+            for (const Mesh &mesh : instance.model->meshes) {
+                glm::vec3 meshMin(std::numeric_limits<float>::max());
+                glm::vec3 meshMax(-std::numeric_limits<float>::max());
+                transformed.resize(mesh.vertices.size());
+                for (unsigned int i = 0; i < mesh.vertices.size(); i++) {
+                    Vertex vertex = mesh.vertices[i];
+                    vertex.Position = glm::vec3(instance.transform * glm::vec4(vertex.Position, 1.0f));
+                    vertex.Normal = normalize(normalMatrix * vertex.Normal);
+                    vertex.Tangent = normalize(linear * vertex.Tangent);
+                    vertex.Bitangent = normalize(linear * vertex.Bitangent);
+                    meshMin = glm::min(meshMin, vertex.Position);
+                    meshMax = glm::max(meshMax, vertex.Position);
+                    transformed[i] = vertex;
+                }
+
+                glm::vec3 cell = glm::floor((meshMin + meshMax) * 0.5f / CELL_SIZE);
+                Key key(std::array<int, 3>{{(int) cell.x, (int) cell.y, (int) cell.z}}, mesh.material.textures);
+                auto found = buckets.find(key);
+                if (found == buckets.end())
+                    found = buckets.insert(std::make_pair(key, Bucket{mesh.material, {}, {}})).first;
+                Bucket &bucket = found->second;
+
+                unsigned int baseVertex = bucket.vertices.size();
+                bucket.vertices.insert(bucket.vertices.end(), transformed.begin(), transformed.end());
+                for (unsigned int i = 0; i + 2 < mesh.indices.size(); i += 3) {
+                    bucket.indices.push_back(baseVertex + mesh.indices[i]);
+                    bucket.indices.push_back(baseVertex + mesh.indices[i + (mirrored ? 2 : 1)]);
+                    bucket.indices.push_back(baseVertex + mesh.indices[i + (mirrored ? 1 : 2)]);
+                }
+                bucket.boundsMin = glm::min(bucket.boundsMin, meshMin);
+                bucket.boundsMax = glm::max(bucket.boundsMax, meshMax);
+            }
+        }
+
+        // one shared buffer, the indices of each batch point straight at its vertices
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        for (auto &entry : buckets) {
+            Bucket &bucket = entry.second;
+            Batch batch{bucket.material, (unsigned int) indices.size(), (unsigned int) bucket.indices.size(),
+                        bucket.boundsMin, bucket.boundsMax};
+            unsigned int baseVertex = vertices.size();
+            vertices.insert(vertices.end(), bucket.vertices.begin(), bucket.vertices.end());
+            for (unsigned int index : bucket.indices)
+                indices.push_back(baseVertex + index);
+            batches.push_back(batch);
+        }
+        // same order as Model::drawOrder, so the variant and textures change as rarely as possible
+        std::stable_sort(batches.begin(), batches.end(), [](const Batch &a, const Batch &b) {
+            return a.material < b.material;
+        });
+        if (batches.empty())
+            return;
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+        glState().bindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+        // same layout as Mesh::setupMesh
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+        glState().bindVertexArray(0);
+
+        std::cout << "static batches: " << instances.size() << " instances merged into " << batches.size()
+                  << " batches, " << vertices.size() << " vertices" << std::endl;
+    }
+
+    // picks the batches inside the view frustum, once per frame before draw() and drawDepth()
+    void cull(const glm::mat4 &viewProjection) {
+        PROFILE_SCOPE("static batch culling");
+        Frustum frustum(viewProjection);
+        visible.clear();
+        for (unsigned int b = 0; b < batches.size(); b++)
+            if (frustum.intersects(batches[b].boundsMin, batches[b].boundsMax))
+                visible.push_back(b);
+    }
+
+    // draws the visible batches, each with the variant its material needs on top of features
+    void draw(ShaderVariants &variants, unsigned int features) {
+        if (visible.empty())
+            return;
+        glState().bindVertexArray(VAO);
+        Shader *shader = nullptr;
+        for (unsigned int b : visible) {
+            Batch &batch = batches[b];
+            Shader &variant = variants.get(features | batch.material.features());
+            if (&variant != shader) {
+                shader = &variant;
+                shader->use();
+                shader->setMat4("model"_uniform, glm::mat4(1.0f));
+            }
+            batch.material.bind(*shader);
+            drawBatch(batch);
+        }
+    }
+
+    // draws the visible batches without textures with depthShader
+    void drawDepth(Shader &depthShader) {
+        if (visible.empty())
+            return;
+        depthShader.use();
+        depthShader.setMat4("model"_uniform, glm::mat4(1.0f));
+        glState().bindVertexArray(VAO);
+        for (unsigned int b : visible)
+            drawBatch(batches[b]);
+    }
+
+    unsigned int batchCount() const {
+        return batches.size();
+    }
+
+    unsigned int visibleCount() const {
+        return visible.size();
+    }
+
+private:
+    struct Instance {
+        Model *model;
+        glm::mat4 transform;
+    };
+
+    struct Batch {
+        Material material;
+        unsigned int firstIndex;
+        unsigned int count;
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+    };
+
+    std::vector<Instance> instances;
+    std::vector<Batch> batches;
+    std::vector<unsigned int> visible;
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+
+    static glm::vec3 normalize(const glm::vec3 &v) {
+        float length = glm::length(v);
+        return length > 0.0f ? v / length : v;
+    }
+
+    static void drawBatch(const Batch &batch) {
+        renderStats().drawElements(GL_TRIANGLES, batch.count, GL_UNSIGNED_INT, (void*)(batch.firstIndex * sizeof(unsigned int)));
+    }
+
+    void releaseBuffers() {
+        if (VAO) {
+            glDeleteVertexArrays(1, &VAO);
+            glDeleteBuffers(1, &VBO);
+            glDeleteBuffers(1, &EBO);
+            VAO = VBO = EBO = 0;
+        }
+        visible.clear();
+    }
+};
+
+constexpr float StaticBatches::CELL_SIZE;
+
+#endif //PROJECT_BASE_STATICBATCHES_H
@@ -0,0 +1,380 @@
+#ifndef PROJECT_BASE_STATICDRAWLIST_H
+#define PROJECT_BASE_STATICDRAWLIST_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+#include <learnopengl/model.h>
+#include <rg/CpuProfiler.h>
+#include <rg/Frustum.h>
+#include <rg/GLExtensions.h>
+#include <rg/GLStateCache.h>
+#include <rg/RenderQueue.h>
+#include <rg/RenderStats.h>
+#include <rg/ShaderVariants.h>
+#include <rg/TextureArrays.h>
+#include <rg/ThreadPool.h>
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <vector>
+
+// Collects the static models drawn with the lighting shader during a frame and submits them.
+// When the driver supports multi draw indirect, the geometry of every registered model is
+// copied into one shared vertex/index buffer and the diffuse and specular textures of every
+// material into texture arrays (see TextureArrays). All meshes whose textures ended up in the
+// same pair of arrays are drawn with a single glMultiDrawElementsIndirect call. The vertex shader
+// fetches the model matrix and texture layers of each draw from a shader storage buffer; the draw
+// index comes from an instanced attribute offset by the command's baseInstance, which works
+// without ARB_shader_draw_parameters. cull() tests the entries against the frustum on the CPU and
+// only the meshes of the visible ones are written into the indirect buffer.
+// Otherwise the meshes of all models are drawn one by one: cull() splits the entries over the
+// thread pool, which culls them against the frustum and records their meshes into a RenderQueue,
+// sorted by variant and material so meshes sharing textures follow each other and the state cache
+// can skip their binds, then front to back.
+class StaticDrawList {
+public:
+    // multiDrawShader is only used when multi draw indirect is available and may be null otherwise
+    StaticDrawList(Shader *multiDrawShader, ThreadPool &pool)
+            : multiDrawShader(glExtensions().multiDrawIndirect ? multiDrawShader : nullptr), pool(pool), queue(pool) {
+    }
+
+    ~StaticDrawList() {
+        releaseBuffers();
+    }
+
+    StaticDrawList(const StaticDrawList &) = delete;
+    StaticDrawList &operator=(const StaticDrawList &) = delete;
+
+    bool multiDraw() const {
+        return multiDrawShader != nullptr;
+    }
+
+    // numbers the materials of the model and copies its meshes into the shared buffers, call for
+    // every model before upload()
+    void addModel(Model &model) {
+        models.push_back(&model);
+        for (Mesh &mesh : model.meshes) {
+            auto material = materials.find(mesh.material.textures);
+            if (material == materials.end()) {
+                material = materials.insert(std::make_pair(mesh.material.textures, (unsigned int) materialMeshes.size())).first;
+                materialMeshes.push_back(&mesh);
+            }
+            mesh.materialIndex = material->second;
+            if (!multiDraw())
+                continue;
+
+            mesh.poolFirstIndex = indices.size();
+            mesh.poolBaseVertex = vertices.size();
+            vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+            indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+        }
+    }
+
+    // creates the shared buffers and texture arrays, the CPU copies are released afterwards
+    void upload() {
+        if (!multiDraw())
+            return;
+
+        // meshes can share a draw call when their diffuse and specular layers live in the same arrays
+        std::map<std::pair<int, int>, unsigned int> groupIndices;
+        for (Mesh *mesh : materialMeshes) {
+            TextureArrays::Location diffuse = textureArrays.add(mesh->material.textures[Material::DIFFUSE]);
+            TextureArrays::Location specular = textureArrays.add(mesh->material.textures[Material::SPECULAR]);
+            std::pair<int, int> arrays(diffuse.array, specular.array);
+            auto group = groupIndices.find(arrays);
+            if (group == groupIndices.end()) {
+                group = groupIndices.insert(std::make_pair(arrays, (unsigned int) groups.size())).first;
+                groups.push_back(arrays);
+            }
+            materialGroups.push_back(group->second);
+            materialLayers.push_back(glm::uvec4(diffuse.layer, specular.layer, 0, 0));
+        }
+        textureArrays.build();
+
+        multiDrawShader->use();
+        multiDrawShader->setInt("material.texture_diffuse1", Material::DIFFUSE);
+        multiDrawShader->setInt("material.texture_specular1", Material::SPECULAR);
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+        glGenBuffers(1, &drawIdVBO);
+        glGenBuffers(1, &drawDataBuffer);
+        glGenBuffers(1, &indirectBuffer);
+
+        glState().bindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+        // same layout as Mesh::setupMesh
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+
+        // draw index, advanced once per instance and offset by baseInstance of each command
+        glBindBuffer(GL_ARRAY_BUFFER, drawIdVBO);
+        glEnableVertexAttribArray(5);
+        glVertexAttribIPointer(5, 1, GL_UNSIGNED_INT, sizeof(unsigned int), (void*)0);
+        glVertexAttribDivisor(5, 1);
+        glState().bindVertexArray(0);
+
+        vertices = std::vector<Vertex>();
+        indices = std::vector<unsigned int>();
+    }
+
+    bool contains(const Model &model) const {
+        return std::find(models.begin(), models.end(), &model) != models.end();
+    }
+
+    // builds the shared buffers and texture arrays again from the added models, after one of them
+    // was imported again or had a texture replaced; the entries of the current frame stay
+    void rebuild() {
+        prepared = false;
+        releaseBuffers();
+        materials.clear();
+        materialMeshes.clear();
+        materialGroups.clear();
+        materialLayers.clear();
+        groups.clear();
+        textureArrays.clear();
+        drawIdCapacity = 0;
+        std::vector<Model *> added;
+        added.swap(models);
+        for (Model *model : added)
+            addModel(*model);
+        upload();
+    }
+
+    void clear() {
+        entries.clear();
+        prepared = false;
+    }
+
+    // visible until the next cull() says otherwise
+    void add(Model &model, const glm::mat4 &transform) {
+        entries.push_back(Entry{&model, transform, true});
+        prepared = false;
+    }
+
+    // finds the entries inside the view frustum, once per frame before draw() and drawDepth(): the
+    // multi draw path writes the commands of their meshes, the fallback path records the meshes
+    void cull(const glm::mat4 &viewProjection, const glm::vec3 &cameraPosition) {
+        PROFILE_SCOPE("draw list culling");
+        Frustum frustum(viewProjection);
+        if (multiDraw()) {
+            for (Entry &entry : entries) {
+                glm::vec3 worldMin, worldMax;
+                Frustum::transformBounds(entry.transform, entry.model->boundsMin, entry.model->boundsMax, worldMin, worldMax);
+                entry.visible = frustum.intersects(worldMin, worldMax);
+            }
+            prepared = false;
+            return;
+        }
+        unsigned int partitions = std::max(1u, std::min(pool.size(), (unsigned int) entries.size()));
+        queue.record(partitions, [&](unsigned int partition, CommandBuffer &buffer) {
+            unsigned int end = entries.size() * (partition + 1) / partitions;
+            for (unsigned int e = entries.size() * partition / partitions; e < end; e++) {
+                const Entry &entry = entries[e];
+                glm::vec3 worldMin, worldMax;
+                Frustum::transformBounds(entry.transform, entry.model->boundsMin, entry.model->boundsMax, worldMin, worldMax);
+                if (!frustum.intersects(worldMin, worldMax))
+                    continue;
+                float distance = glm::length((worldMin + worldMax) * 0.5f - cameraPosition);
+                for (Mesh &mesh : entry.model->meshes)
+                    buffer.draw(RenderQueue::sortKey(mesh.material.features(), mesh.materialIndex, distance),
+                                mesh.material, mesh.VAO, mesh.indices.size(), entry.transform);
+            }
+        });
+    }
+
+    // meshes left to draw by the last cull(), as commands of the multi draw path or recorded by the fallback
+    unsigned int recordedCount() const {
+        return multiDraw() ? commands.size() : queue.commandCount();
+    }
+
+    // draws everything added since the last clear(); the fallback path draws what cull() recorded,
+    // every mesh with the variant of features plus what its material needs. The multi draw path uses multiDrawOverride
+    // instead of the shader given to the constructor when it is set, its samplers must point at
+    // Material::DIFFUSE and Material::SPECULAR
+    void draw(ShaderVariants &variants, unsigned int features, Shader *multiDrawOverride = nullptr) {
+        prepare();
+        if (!multiDraw()) {
+            queue.submit(variants, features);
+            return;
+        }
+        if (commands.empty())
+            return;
+
+        bindDrawBuffers();
+        (multiDrawOverride ? multiDrawOverride : multiDrawShader)->use();
+        glState().bindVertexArray(VAO);
+        for (unsigned int g = 0; g < groupCounts.size(); g++) {
+            if (groupCounts[g] == 0)
+                continue;
+            textureArrays.bind(groups[g].first, Material::DIFFUSE);
+            textureArrays.bind(groups[g].second, Material::SPECULAR);
+            renderStats().multiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                                    (void*)(groupOffsets[g] * sizeof(DrawElementsIndirectCommand)),
+                                                    groupCounts[g], 0, indexCount(groupOffsets[g], groupCounts[g]));
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+    // draws the same geometry without textures; the fallback path draws with depthShader, the multi
+    // draw path with depthMultiDrawShader in a single call
+    void drawDepth(Shader &depthShader, Shader *depthMultiDrawShader) {
+        prepare();
+        if (!multiDraw()) {
+            queue.submitDepth(depthShader);
+            return;
+        }
+        if (commands.empty())
+            return;
+
+        bindDrawBuffers();
+        depthMultiDrawShader->use();
+        glState().bindVertexArray(VAO);
+        renderStats().multiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)0, commands.size(), 0,
+                                                indexCount(0, commands.size()));
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+private:
+    struct Entry {
+        Model *model;
+        glm::mat4 transform;
+        bool visible;
+    };
+
+    // std430 layout of DrawData in lighting_mdi.vs, material holds the diffuse and specular layer
+    struct DrawData {
+        glm::mat4 model;
+        glm::uvec4 material;
+    };
+    static_assert(sizeof(DrawData) == 80, "DrawData must match the std430 layout");
+
+    // builds and uploads the draw commands of the visible entries for the multi draw path, once per cull()
+    void prepare() {
+        if (prepared)
+            return;
+        prepared = true;
+
+        if (!multiDraw())
+            return;
+
+        // bucket the meshes of every entry by texture arrays so each group is one contiguous command range
+        groupCounts.assign(groups.size(), 0);
+        for (const Entry &entry : entries)
+            if (entry.visible)
+                for (const Mesh &mesh : entry.model->meshes)
+                    groupCounts[materialGroups[mesh.materialIndex]]++;
+
+        groupOffsets.resize(groupCounts.size());
+        unsigned int drawCount = 0;
+        for (unsigned int i = 0; i < groupCounts.size(); i++) {
+            groupOffsets[i] = drawCount;
+            drawCount += groupCounts[i];
+        }
+
+        commands.resize(drawCount);
+        drawData.resize(drawCount);
+        if (drawCount == 0)
+            return;
+
+        groupCursor = groupOffsets;
+        for (unsigned int e = 0; e < entries.size(); e++) {
+            if (!entries[e].visible)
+                continue;
+            for (const Mesh &mesh : entries[e].model->meshes) {
+                unsigned int i = groupCursor[materialGroups[mesh.materialIndex]]++;
+                commands[i].count = mesh.indices.size();
+                commands[i].instanceCount = 1;
+                commands[i].firstIndex = mesh.poolFirstIndex;
+                commands[i].baseVertex = mesh.poolBaseVertex;
+                commands[i].baseInstance = i;
+                drawData[i].model = entries[e].transform;
+                drawData[i].material = materialLayers[mesh.materialIndex];
+            }
+        }
+
+        if (drawCount > drawIdCapacity) {
+            std::vector<unsigned int> drawIds(drawCount);
+            for (unsigned int i = 0; i < drawCount; i++)
+                drawIds[i] = i;
+            glBindBuffer(GL_ARRAY_BUFFER, drawIdVBO);
+            glBufferData(GL_ARRAY_BUFFER, drawIds.size() * sizeof(unsigned int), drawIds.data(), GL_STATIC_DRAW);
+            drawIdCapacity = drawCount;
+        }
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawDataBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, drawData.size() * sizeof(DrawData), drawData.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STREAM_DRAW);
+        renderStats().bufferUpload(drawData.size() * sizeof(DrawData) + commands.size() * sizeof(DrawElementsIndirectCommand));
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+    // indices drawn by count commands from first on, for the stats of a multi draw
+    unsigned long long indexCount(unsigned int first, unsigned int count) const {
+        unsigned long long indices = 0;
+        for (unsigned int i = first; i < first + count; i++)
+            indices += (unsigned long long) commands[i].count * commands[i].instanceCount;
+        return indices;
+    }
+
+    void releaseBuffers() {
+        if (VAO) {
+            glDeleteVertexArrays(1, &VAO);
+            glDeleteBuffers(1, &VBO);
+            glDeleteBuffers(1, &EBO);
+            glDeleteBuffers(1, &drawIdVBO);
+            glDeleteBuffers(1, &drawDataBuffer);
+            glDeleteBuffers(1, &indirectBuffer);
+            VAO = VBO = EBO = drawIdVBO = drawDataBuffer = indirectBuffer = 0;
+        }
+    }
+
+    void bindDrawBuffers() {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, drawDataBuffer);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    }
+
+    Shader *multiDrawShader;
+    ThreadPool &pool;
+    RenderQueue queue;
+    std::vector<Model *> models;
+    std::vector<Entry> entries;
+
+    // material textures -> material index, with one mesh per material to take its textures from
+    std::map<std::array<unsigned int, Material::NUM_UNITS>, unsigned int> materials;
+    std::vector<Mesh*> materialMeshes;
+    // per material: its draw group and texture layers; per group: its diffuse and specular array
+    std::vector<unsigned int> materialGroups;
+    std::vector<glm::uvec4> materialLayers;
+    std::vector<std::pair<int, int>> groups;
+    TextureArrays textureArrays;
+
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    unsigned int VAO = 0, VBO = 0, EBO = 0, drawIdVBO = 0, drawDataBuffer = 0, indirectBuffer = 0;
+    unsigned int drawIdCapacity = 0;
+
+    std::vector<unsigned int> groupCounts, groupOffsets, groupCursor;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<DrawData> drawData;
+    bool prepared = false;
+};
+
+#endif //PROJECT_BASE_STATICDRAWLIST_H
@@ -0,0 +1,188 @@
+#ifndef PROJECT_BASE_STREAMBUFFER_H
+#define PROJECT_BASE_STREAMBUFFER_H
+
+#include <glad/glad.h>
+
+#include <rg/CpuProfiler.h>
+#include <rg/GLExtensions.h>
+#include <rg/RenderStats.h>
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// One buffer for all data written every frame (uniform blocks, light lists), handed out by a bump
+// allocator that starts over each frame, so nothing is reallocated once it is created.
+// With buffer storage the buffer holds FRAME_COUNT regions of frameSize and stays persistently and
+// coherently mapped: a frame writes straight into its region, and a fence set at the end of the
+// frame is waited on before the region is used again, three frames later. Without it the buffer
+// is one region that is orphaned at the start of every frame, allocations are written to a copy
+// in memory and uploaded with glBufferSubData by flush().
+class StreamBuffer {
+public:
+    static const unsigned int FRAME_COUNT = 3;
+
+    struct Allocation {
+        // where to write the data, null if the frame's region is full
+        void *data = nullptr;
+        // from the start of the buffer, for glBindBufferRange or as the first texel of a buffer texture
+        GLintptr offset = 0;
+        GLsizeiptr size = 0;
+    };
+
+    unsigned int ID = 0;
+
+    explicit StreamBuffer(GLsizeiptr frameSize) : frameSize(frameSize) {
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        uniformOffsetAlignment = alignment;
+
+        glGenBuffers(1, &ID);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+        if (glExtensions().bufferStorage) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glExtensions().BufferStorage(GL_COPY_WRITE_BUFFER, frameSize * FRAME_COUNT, nullptr, flags);
+            mapped = (char *) glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, frameSize * FRAME_COUNT, flags);
+            if (!mapped) {
+                // the storage is immutable, start over with a plain buffer
+                glDeleteBuffers(1, &ID);
+                glGenBuffers(1, &ID);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+            }
+        }
+        if (!mapped) {
+            glBufferData(GL_COPY_WRITE_BUFFER, frameSize, nullptr, GL_STREAM_DRAW);
+            staging.resize(frameSize);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    ~StreamBuffer() {
+        for (GLsync fence : fences)
+            if (fence)
+                glDeleteSync(fence);
+        // deleting the buffer unmaps it
+        glDeleteBuffers(1, &ID);
+    }
+
+    StreamBuffer(const StreamBuffer &) = delete;
+    StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+    bool persistent() const {
+        return mapped != nullptr;
+    }
+
+    // moves to the next region, waiting if the GPU may still read it; call before the first allocation of a frame
+    void beginFrame() {
+        PROFILE_SCOPE("stream buffer wait");
+        if (persistent()) {
+            region = (region + 1) % FRAME_COUNT;
+            GLsync &fence = fences[region];
+            if (fence) {
+                if (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED) {
+                    stalls++;
+                    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+                        ;
+                }
+                glDeleteSync(fence);
+                fence = nullptr;
+            }
+        } else {
+            // fresh storage for this frame, draws of the last one keep reading the old
+            glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+            glBufferData(GL_COPY_WRITE_BUFFER, frameSize, nullptr, GL_STREAM_DRAW);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        cursor = flushed = 0;
+    }
+
+    // size bytes at a multiple of alignment in this frame's region
+    Allocation allocate(GLsizeiptr size, GLsizeiptr alignment = 16) {
+        GLsizeiptr start = (cursor + alignment - 1) / alignment * alignment;
+        if (start + size > frameSize) {
+            if (!overflowReported)
+                std::cout << "ERROR::STREAM_BUFFER::FRAME_REGION_FULL: " << start + size << " of " << frameSize
+                          << " bytes" << std::endl;
+            overflowReported = true;
+            return Allocation();
+        }
+        cursor = start + size;
+        Allocation allocation;
+        allocation.offset = regionStart() + start;
+        allocation.size = size;
+        allocation.data = persistent() ? mapped + allocation.offset : staging.data() + start;
+        return allocation;
+    }
+
+    // allocates with the alignment uniform block ranges need and copies value in
+    template <typename T>
+    Allocation writeUniforms(const T &value) {
+        PROFILE_SCOPE("uniform upload");
+        Allocation allocation = allocate(sizeof(T), uniformOffsetAlignment);
+        if (allocation.data)
+            std::memcpy(allocation.data, &value, sizeof(T));
+        return allocation;
+    }
+
+    // makes what was written since the last flush visible to the GPU, the coherent mapping needs nothing
+    void flush() {
+        PROFILE_SCOPE("uniform upload");
+        if (!persistent() && cursor > flushed) {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, flushed, cursor - flushed, staging.data() + flushed);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        renderStats().bufferUpload(cursor - flushed);
+        flushed = cursor;
+    }
+
+    // call after the last draw that reads this frame's region
+    void endFrame() {
+        flush();
+        if (persistent())
+            fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        lastFrameBytes = cursor;
+    }
+
+    void bindUniformRange(unsigned int binding, const Allocation &allocation) const {
+        if (allocation.data)
+            glBindBufferRange(GL_UNIFORM_BUFFER, binding, ID, allocation.offset, allocation.size);
+    }
+
+    GLsizeiptr frameCapacity() const {
+        return frameSize;
+    }
+
+    // bytes in the buffer, every region or the one orphaned frame after frame
+    GLsizeiptr size() const {
+        return persistent() ? frameSize * FRAME_COUNT : frameSize;
+    }
+
+    // bytes the last finished frame allocated
+    GLsizeiptr lastFrameUsage() const {
+        return lastFrameBytes;
+    }
+
+    // frames that had to wait for the GPU to release their region
+    unsigned int stallCount() const {
+        return stalls;
+    }
+
+private:
+    GLsizeiptr frameSize;
+    GLsizeiptr uniformOffsetAlignment = 256;
+    char *mapped = nullptr;
+    std::vector<char> staging;
+    GLsync fences[FRAME_COUNT] = {};
+    unsigned int region = 0;
+    GLsizeiptr cursor = 0, flushed = 0;
+    GLsizeiptr lastFrameBytes = 0;
+    unsigned int stalls = 0;
+    bool overflowReported = false;
+
+    GLintptr regionStart() const {
+        return persistent() ? region * frameSize : 0;
+    }
+};
+
+#endif //PROJECT_BASE_STREAMBUFFER_H
@@ -0,0 +1,148 @@
+#ifndef PROJECT_BASE_TEXTUREARRAYS_H
+#define PROJECT_BASE_TEXTUREARRAYS_H
+
+#include <glad/glad.h>
+
+#include <rg/GLStateCache.h>
+
+#include <iostream>
+#include <map>
+#include <vector>
+
+// Copies 2D textures into GL_TEXTURE_2D_ARRAY objects so draws that only differ in their textures
+// can share one draw call and pick their texture by layer.
+// Textures are resampled on the GPU (framebuffer blit with linear filtering) to a square power of
+// two size between MIN_SIZE and MAX_SIZE, the nearest one to their larger side, and stored as RGBA8.
+// Every size gets its own array, split further when it would go past GL_MAX_ARRAY_TEXTURE_LAYERS.
+// Single channel textures end up as (r, 0, 0, 1), which is what sampling them directly gave too.
+class TextureArrays {
+public:
+    static const int MIN_SIZE = 256;
+    static const int MAX_SIZE = 2048;
+    // layer of a texture that was never added
+    static const unsigned int NO_LAYER = 0xFFFFFFFFu;
+
+    struct Location {
+        int array = -1;
+        unsigned int layer = NO_LAYER;
+    };
+
+    TextureArrays() = default;
+
+    ~TextureArrays() {
+        clear();
+    }
+
+    TextureArrays(const TextureArrays &) = delete;
+    TextureArrays &operator=(const TextureArrays &) = delete;
+
+    // reserves a layer for the texture, adding the same texture again returns the same location
+    Location add(unsigned int texture) {
+        if (texture == 0)
+            return Location();
+        auto found = locations.find(texture);
+        if (found != locations.end())
+            return found->second;
+
+        GLint width = 0, height = 0;
+        glState().bindTexture(0, GL_TEXTURE_2D, texture);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+        int size = layerSize(width > height ? width : height);
+
+        if (maxLayers == 0)
+            glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+        int array = -1;
+        for (unsigned int i = 0; i < arrays.size(); i++)
+            if (arrays[i].size == size && (GLint) arrays[i].sources.size() < maxLayers)
+                array = i;
+        if (array < 0) {
+            arrays.push_back(Array{0, size, {}});
+            array = arrays.size() - 1;
+        }
+
+        Location location;
+        location.array = array;
+        location.layer = arrays[array].sources.size();
+        arrays[array].sources.push_back(Source{texture, width, height});
+        locations[texture] = location;
+        return location;
+    }
+
+    // creates the arrays and copies every added texture into its layer
+    void build() {
+        GLuint framebuffers[2];
+        glGenFramebuffers(2, framebuffers);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffers[0]);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers[1]);
+
+        for (Array &array : arrays) {
+            glGenTextures(1, &array.ID);
+            glState().bindTexture(0, GL_TEXTURE_2D_ARRAY, array.ID);
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, array.size, array.size, array.sources.size(), 0,
+                         GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+            for (unsigned int layer = 0; layer < array.sources.size(); layer++) {
+                const Source &source = array.sources[layer];
+                glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, source.texture, 0);
+                glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, array.ID, 0, layer);
+                glBlitFramebuffer(0, 0, source.width, source.height, 0, 0, array.size, array.size,
+                                  GL_COLOR_BUFFER_BIT, GL_LINEAR);
+            }
+
+            glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+            std::cout << "texture array " << array.size << "x" << array.size << ": " << array.sources.size() << " layers" << std::endl;
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(2, framebuffers);
+    }
+
+    // deletes the arrays and forgets every added texture
+    void clear() {
+        for (Array &array : arrays)
+            glDeleteTextures(1, &array.ID);
+        arrays.clear();
+        locations.clear();
+    }
+
+    unsigned int size() const {
+        return arrays.size();
+    }
+
+    void bind(int array, unsigned int unit) const {
+        if (array >= 0)
+            glState().bindTexture(unit, GL_TEXTURE_2D_ARRAY, arrays[array].ID);
+    }
+
+private:
+    struct Source {
+        unsigned int texture;
+        GLint width, height;
+    };
+
+    struct Array {
+        unsigned int ID;
+        int size;
+        std::vector<Source> sources;
+    };
+
+    std::vector<Array> arrays;
+    std::map<unsigned int, Location> locations;
+    GLint maxLayers = 0;
+
+    // power of two closest to size, clamped to [MIN_SIZE, MAX_SIZE]
+    static int layerSize(int size) {
+        int layer = MIN_SIZE;
+        while (layer < MAX_SIZE && size > layer + layer / 2)
+            layer *= 2;
+        return layer;
+    }
+};
+
+#endif //PROJECT_BASE_TEXTUREARRAYS_H
@@ -0,0 +1,110 @@
+#ifndef PROJECT_BASE_THREADPOOL_H
+#define PROJECT_BASE_THREADPOOL_H
+
+#include <rg/CpuProfiler.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads for splitting per frame CPU work into independent jobs.
+// parallelFor() hands out the indices of one batch to the workers and the calling thread and
+// returns once every job is done, so the caller can use the results right away. Jobs must not
+// touch GL, only the thread that owns the context may.
+class ThreadPool {
+public:
+    // threads counts the calling thread too, one thread means parallelFor() runs everything inline
+    explicit ThreadPool(unsigned int threads = std::thread::hardware_concurrency()) {
+        for (unsigned int i = 1; i < threads; i++)
+            workers.emplace_back([this, i]() { work(i); });
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    unsigned int size() const {
+        return workers.size() + 1;
+    }
+
+    // calls job(i) for every i in [0, count), in no particular order and on any thread
+    void parallelFor(unsigned int count, const std::function<void(unsigned int)> &job) {
+        if (workers.empty() || count <= 1) {
+            for (unsigned int i = 0; i < count; i++)
+                job(i);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current = &job;
+            jobCount = count;
+            nextJob = 0;
+            busyWorkers = workers.size();
+            batch++;
+        }
+        wake.notify_all();
+        runJobs(job, count);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return busyWorkers == 0; });
+        current = nullptr;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(unsigned int)> *current = nullptr;
+    unsigned int jobCount = 0;
+    std::atomic<unsigned int> nextJob{0};
+    // every worker takes part in every batch, the next one only starts once all of them are back
+    unsigned int busyWorkers = 0;
+    unsigned int batch = 0;
+    bool stopping = false;
+
+    void runJobs(const std::function<void(unsigned int)> &job, unsigned int count) {
+        for (unsigned int i = nextJob++; i < count; i = nextJob++)
+            job(i);
+    }
+
+    void work(unsigned int index) {
+        cpuProfiler().nameThread("worker " + std::to_string(index));
+        unsigned int seenBatch = 0;
+        while (true) {
+            const std::function<void(unsigned int)> *job;
+            unsigned int count;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]() { return stopping || batch != seenBatch; });
+                if (stopping)
+                    return;
+                seenBatch = batch;
+                job = current;
+                count = jobCount;
+            }
+            runJobs(*job, count);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--busyWorkers == 0)
+                    done.notify_one();
+            }
+        }
+    }
+};
+
+#endif //PROJECT_BASE_THREADPOOL_H
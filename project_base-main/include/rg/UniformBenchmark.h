@@ -0,0 +1,120 @@
+#ifndef PROJECT_BASE_UNIFORMBENCHMARK_H
+#define PROJECT_BASE_UNIFORMBENCHMARK_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+#include <learnopengl/model.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Measures the CPU cost of the uniform uploads a frame of the scene does: a model matrix and the
+// samplers of every mesh of the given models. The same uploads are timed three ways:
+//   strings - what Shader and Mesh did before, a std::string and glGetUniformLocation per upload
+//   hashed  - names hashed at compile time and looked up in the shader's reflected uniforms
+//   handles - locations resolved once up front
+// Since materials point samplers at fixed units once, the render loop itself only uploads the model
+// matrix now; the sampler uploads are kept here so the three ways stay comparable.
+// Run with --benchmark-uniforms, the results are printed and the program exits.
+class UniformBenchmark {
+public:
+    UniformBenchmark(Shader &shader, const std::vector<Model*> &models) : shader(shader), models(models) {
+    }
+
+    void run(unsigned int frames) {
+        shader.use();
+        unsigned int uploads = 0;
+        for (Model *model : models)
+            for (Mesh &mesh : model->meshes)
+                uploads += 1 + mesh.textures.size();
+
+        double strings = measure(frames, [this]() { stringsFrame(); });
+        double hashed = measure(frames, [this]() { hashedFrame(); });
+        double handles = measure(frames, [this]() { handlesFrame(); });
+
+        std::cout << "uniform uploads per frame: " << uploads << ", " << frames << " frames" << std::endl;
+        std::cout << "  strings: " << strings << " us/frame" << std::endl;
+        std::cout << "  hashed:  " << hashed << " us/frame" << std::endl;
+        std::cout << "  handles: " << handles << " us/frame" << std::endl;
+    }
+
+private:
+    Shader &shader;
+    std::vector<Model*> models;
+    glm::mat4 model = glm::mat4(1.0f);
+
+    template <typename Frame>
+    double measure(unsigned int frames, Frame frame) {
+        // warm up and drain whatever is still queued so it doesn't end up in the timing
+        frame();
+        glFinish();
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < frames; i++)
+            frame();
+        glFinish();
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / frames;
+    }
+
+    void stringsFrame() {
+        for (Model *m : models) {
+            for (Mesh &mesh : m->meshes) {
+                glUniformMatrix4fv(glGetUniformLocation(shader.ID, std::string("model").c_str()), 1, GL_FALSE, &model[0][0]);
+                unsigned int diffuseNr = 1, specularNr = 1, normalNr = 1, heightNr = 1;
+                for (unsigned int i = 0; i < mesh.textures.size(); i++) {
+                    std::string number;
+                    std::string name = mesh.textures[i].type;
+                    if (name == "texture_diffuse")
+                        number = std::to_string(diffuseNr++);
+                    else if (name == "texture_specular")
+                        number = std::to_string(specularNr++);
+                    else if (name == "texture_normal")
+                        number = std::to_string(normalNr++);
+                    else if (name == "texture_height")
+                        number = std::to_string(heightNr++);
+                    glUniform1i(glGetUniformLocation(shader.ID, (mesh.glslIdentifierPrefix + name + number).c_str()), i);
+                }
+            }
+        }
+    }
+
+    void hashedFrame() {
+        for (Model *m : models) {
+            for (Mesh &mesh : m->meshes) {
+                shader.setMat4("model"_uniform, model);
+                for (unsigned int unit = 0; unit < Material::NUM_UNITS; unit++)
+                    if (mesh.material.textures[unit])
+                        shader.setInt(mesh.material.samplerNames[unit], unit);
+            }
+        }
+    }
+
+    void handlesFrame() {
+        if (samplerLocations.empty()) {
+            modelLocation = shader.uniformLocation("model"_uniform);
+            for (Model *m : models)
+                for (Mesh &mesh : m->meshes)
+                    for (unsigned int unit = 0; unit < Material::NUM_UNITS; unit++)
+                        samplerLocations.push_back(shader.uniformLocation(mesh.material.samplerNames[unit]));
+        }
+
+        unsigned int sampler = 0;
+        for (Model *m : models) {
+            for (Mesh &mesh : m->meshes) {
+                shader.setMat4(modelLocation, model);
+                for (unsigned int unit = 0; unit < Material::NUM_UNITS; unit++, sampler++)
+                    if (mesh.material.textures[unit])
+                        shader.setInt(samplerLocations[sampler], unit);
+            }
+        }
+    }
+
+    GLint modelLocation = -1;
+    std::vector<GLint> samplerLocations;
+};
+
+#endif //PROJECT_BASE_UNIFORMBENCHMARK_H
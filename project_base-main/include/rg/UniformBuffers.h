@@ -0,0 +1,139 @@
+#ifndef PROJECT_BASE_UNIFORMBUFFERS_H
+#define PROJECT_BASE_UNIFORMBUFFERS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+#include <rg/RenderStats.h>
+
+#include <cmath>
+
+// Uniform blocks shared by every scene shader. The structs below mirror the std140
+// layout of the blocks declared in the shaders, floats are packed into the fourth
+// component of the preceding vec3 exactly like std140 does.
+
+const unsigned int FRAME_UNIFORMS_BINDING = 0;
+const unsigned int LIGHT_UNIFORMS_BINDING = 1;
+const unsigned int CLUSTER_UNIFORMS_BINDING = 2;
+const unsigned int NUM_POINT_LIGHTS = 6;
+
+struct PointLight {
+    glm::vec3 position;
+    float constant;
+    glm::vec3 ambient;
+    float linear;
+    glm::vec3 diffuse;
+    float quadratic;
+    glm::vec3 specular;
+    float padding;
+};
+
+struct DirLight {
+    glm::vec3 direction;
+    float padding0;
+    glm::vec3 ambient;
+    float padding1;
+    glm::vec3 diffuse;
+    float padding2;
+    glm::vec3 specular;
+    float padding3;
+};
+
+// layout (std140) uniform Frame
+struct FrameUniforms {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec3 viewPosition;
+    float padding;
+};
+
+// layout (std140) uniform Lights
+struct LightUniforms {
+    DirLight dirLight;
+    PointLight pointLights[NUM_POINT_LIGHTS];
+};
+
+// layout (std140) uniform Clusters, see ClusteredLights
+struct ClusterUniforms {
+    glm::uvec4 grid;
+    glm::vec4 scale;
+};
+
+static_assert(sizeof(PointLight) == 64, "PointLight must match the std140 layout");
+static_assert(sizeof(DirLight) == 64, "DirLight must match the std140 layout");
+static_assert(sizeof(FrameUniforms) == 144, "FrameUniforms must match the std140 layout");
+static_assert(sizeof(LightUniforms) == 448, "LightUniforms must match the std140 layout");
+static_assert(sizeof(ClusterUniforms) == 32, "ClusterUniforms must match the std140 layout");
+
+// attenuation below which a point light counts as off, 5/256 is darker than an 8 bit step
+const float POINT_LIGHT_CUTOFF = 5.0f / 256.0f;
+
+// distance at which the light's attenuation falls below POINT_LIGHT_CUTOFF of its brightest colour
+float pointLightRadius(const PointLight &light) {
+    float brightest = glm::max(glm::max(light.diffuse.r, light.diffuse.g), light.diffuse.b);
+    brightest = glm::max(brightest, glm::max(glm::max(light.ambient.r, light.ambient.g), light.ambient.b));
+    // constant + linear * d + quadratic * d^2 = brightest / POINT_LIGHT_CUTOFF
+    float c = light.constant - brightest / POINT_LIGHT_CUTOFF;
+    if (c >= 0.0f)
+        return 0.0f;
+    if (light.quadratic > 0.0f)
+        return (-light.linear + std::sqrt(light.linear * light.linear - 4.0f * light.quadratic * c)) / (2.0f * light.quadratic);
+    if (light.linear > 0.0f)
+        return -c / light.linear;
+    // never fades, big enough to cover the scene
+    return 10000.0f;
+}
+
+class UniformBuffer {
+public:
+    unsigned int ID = 0;
+
+    explicit UniformBuffer(GLsizeiptr size, const void *data = nullptr, GLenum usage = GL_DYNAMIC_DRAW) : size(size) {
+        glGenBuffers(1, &ID);
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferData(GL_UNIFORM_BUFFER, size, data, usage);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    ~UniformBuffer() {
+        glDeleteBuffers(1, &ID);
+    }
+
+    UniformBuffer(const UniformBuffer &) = delete;
+    UniformBuffer &operator=(const UniformBuffer &) = delete;
+
+    void update(GLintptr offset, GLsizeiptr dataSize, const void *data) {
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferSubData(GL_UNIFORM_BUFFER, offset, dataSize, data);
+        renderStats().bufferUpload(dataSize);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    void bind(unsigned int binding) {
+        glBindBufferRange(GL_UNIFORM_BUFFER, binding, ID, 0, size);
+    }
+
+    void bindRange(unsigned int binding, GLintptr offset, GLsizeiptr rangeSize) {
+        glBindBufferRange(GL_UNIFORM_BUFFER, binding, ID, offset, rangeSize);
+    }
+
+    // rounds size up to the alignment required for glBindBufferRange offsets
+    static GLintptr alignedSize(GLsizeiptr size) {
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        return (size + alignment - 1) / alignment * alignment;
+    }
+
+private:
+    GLsizeiptr size;
+};
+
+// points the Frame, Lights and Clusters blocks of the shader at their binding points, blocks the shader doesn't use are skipped
+void bindSceneUniformBlocks(Shader &shader) {
+    shader.bindUniformBlock("Frame", FRAME_UNIFORMS_BINDING);
+    shader.bindUniformBlock("Lights", LIGHT_UNIFORMS_BINDING);
+    shader.bindUniformBlock("Clusters", CLUSTER_UNIFORMS_BINDING);
+}
+
+#endif //PROJECT_BASE_UNIFORMBUFFERS_H
@@ -6,14 +6,12 @@ in vec3 FragPos;
 
 struct PointLight {
     vec3 position;
-
-    vec3 specular;
-    vec3 diffuse;
-    vec3 ambient;
-
     float constant;
+    vec3 ambient;
     float linear;
+    vec3 diffuse;
     float quadratic;
+    vec3 specular;
 };
 
 struct DirLight {
@@ -25,14 +23,52 @@ struct DirLight {
 };
 
 uniform sampler2D texture1;
-uniform PointLight pointLight1; // oil lamp
-uniform PointLight pointLight2;
-uniform PointLight pointLight3; // treasure
-uniform PointLight pointLight4;
-uniform PointLight pointLight5; // house
-uniform PointLight pointLight6; // fire
-uniform DirLight dirLight;
-uniform vec3 viewPosition;
+// sampled once in main, derivatives are undefined inside the light loop
+vec4 texColor;
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+layout (std140) uniform Lights {
+    DirLight dirLight;
+    PointLight pointLights[6]; // 0, 1 oil lamps, 2, 3 treasure, 4 house, 5 fire
+};
+
+// point lights of the pixel's cluster, see ClusteredLights
+layout (std140) uniform Clusters {
+    uvec4 clusterGrid;  // clusters along x, y and depth, first texel of this frame's clusterRanges; 0 without lists
+    vec4 clusterScale;  // clusters per pixel along x and y, depth slices per log(depth), log(near) * slices per log(depth)
+};
+uniform samplerBuffer clusterLights;        // 4 texels per PointLight
+uniform usamplerBuffer clusterRanges;       // first texel, count in clusterLightIndices
+uniform usamplerBuffer clusterLightIndices;
+
+PointLight clusterLight(uint index)
+{
+    int texel = int(index) * 4;
+    vec4 positionConstant = texelFetch(clusterLights, texel);
+    vec4 ambientLinear = texelFetch(clusterLights, texel + 1);
+    vec4 diffuseQuadratic = texelFetch(clusterLights, texel + 2);
+    PointLight light;
+    light.position = positionConstant.xyz;
+    light.constant = positionConstant.w;
+    light.ambient = ambientLinear.xyz;
+    light.linear = ambientLinear.w;
+    light.diffuse = diffuseQuadratic.xyz;
+    light.quadratic = diffuseQuadratic.w;
+    light.specular = texelFetch(clusterLights, texel + 3).xyz;
+    return light;
+}
+uvec2 clusterRange(vec3 fragPos)
+{
+    if (clusterGrid.x == 0u)
+        return uvec2(0u);
+    float depth = -(view * vec4(fragPos, 1.0)).z;
+    uvec2 tile = min(uvec2(gl_FragCoord.xy * clusterScale.xy), clusterGrid.xy - 1u);
+    uint slice = uint(clamp(log(depth) * clusterScale.z - clusterScale.w, 0.0, float(clusterGrid.z - 1u)));
+    return texelFetch(clusterRanges, int(clusterGrid.w + (slice * clusterGrid.y + tile.y) * clusterGrid.x + tile.x)).xy;
+}
 
 vec4 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
 {
@@ -47,10 +83,6 @@ vec4 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     // attenuation
     float distance = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
-    // blending
-    vec4 texColor = vec4(texture(texture1, TexCoords));
-    if(texColor.a < 0.1)
-        discard;
     // combine results
     vec4 ambient = vec4(light.ambient, 1.0) * texColor;
     vec4 diffuse = vec4(light.diffuse, 1.0) * diff * texColor;
@@ -72,10 +104,6 @@ vec4 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
 //     vec3 reflectDir = reflect(-lightDir, normal);
 //     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
 
-    vec4 texColor = vec4(texture(texture1, TexCoords));
-    if(texColor.a < 0.1)
-        discard;
-
     // combine results
     vec4 ambient = vec4(light.ambient, 1.0) * texColor;
     vec4 diffuse = vec4(light.diffuse, 1.0) * diff * texColor;
@@ -89,12 +117,15 @@ void main()
 {
     vec3 normal = vec3(0.0f, 1.0f, 0.0f);
     vec3 viewDir = normalize(viewPosition - FragPos);
-    vec4 result = CalcPointLight(pointLight1, normal, FragPos, viewDir) +
-                                      CalcPointLight(pointLight2, normal, FragPos, viewDir) +
-                                      CalcPointLight(pointLight3, normal, FragPos, viewDir) +
-                                      CalcPointLight(pointLight4, normal, FragPos, viewDir) +
-                                      CalcPointLight(pointLight5, normal, FragPos, viewDir) +
-                                      CalcPointLight(pointLight6, normal, FragPos, viewDir) +
-                                      CalcDirLight(dirLight, normal, viewDir);
+    // blending
+    texColor = vec4(texture(texture1, TexCoords));
+#ifdef ALPHA_TEST
+    if(texColor.a < 0.1)
+        discard;
+#endif
+    vec4 result = CalcDirLight(dirLight, normal, viewDir);
+    uvec2 range = clusterRange(FragPos);
+    for (uint i = 0u; i < range.y; i++)
+        result += CalcPointLight(clusterLight(texelFetch(clusterLightIndices, int(range.x + i)).r), normal, FragPos, viewDir);
     FragColor = result;
 }
\ No newline at end of file
@@ -5,9 +5,13 @@ layout (location = 1) in vec2 aTexCoords;
 out vec2 TexCoords;
 out vec3 FragPos;
 
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main()
 {
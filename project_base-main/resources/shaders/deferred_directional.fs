@@ -0,0 +1,62 @@
+#version 330 core
+out vec4 FragColor;
+
+struct DirLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+struct PointLight {
+    vec3 position;
+    float constant;
+    vec3 ambient;
+    float linear;
+    vec3 diffuse;
+    float quadratic;
+    vec3 specular;
+};
+
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+layout (std140) uniform Lights {
+    DirLight dirLight;
+    PointLight pointLights[6];
+};
+
+uniform sampler2D gAlbedoSpecular;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+uniform mat4 inverseViewProjection;
+// the part of the G-buffer drawn this frame, from its lower-left corner
+uniform vec2 renderSize;
+
+// directional light of the deferred renderer, same as CalcDirLight in lighting.fs
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    // nothing was drawn here, leave it to the skybox
+    if (depth == 1.0)
+        discard;
+
+    vec4 albedoSpecular = texelFetch(gAlbedoSpecular, pixel, 0);
+    vec3 normal = texelFetch(gNormal, pixel, 0).xyz;
+    vec4 position = inverseViewProjection * vec4(gl_FragCoord.xy / renderSize * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+    vec3 fragPos = position.xyz / position.w;
+
+    vec3 viewDir = normalize(viewPosition - fragPos);
+    vec3 lightDir = normalize(-dirLight.direction);
+    float diff = max(dot(normal, lightDir), 0.0);
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), 32.0);
+
+    vec3 ambient = dirLight.ambient * albedoSpecular.rgb;
+    vec3 diffuse = dirLight.diffuse * diff * albedoSpecular.rgb;
+    vec3 specular = dirLight.specular * spec * albedoSpecular.a;
+    FragColor = vec4(ambient + diffuse + specular, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,8 @@
+#version 330 core
+
+// one triangle that covers the screen, no vertex buffer needed
+void main()
+{
+    vec2 position = vec2(gl_VertexID == 1 ? 3.0 : -1.0, gl_VertexID == 2 ? 3.0 : -1.0);
+    gl_Position = vec4(position, 0.0, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#version 330 core
+out vec4 FragColor;
+
+flat in vec4 PositionRadius;
+flat in vec3 Attenuation; // constant, linear, quadratic
+flat in vec3 Ambient;
+flat in vec3 Diffuse;
+flat in vec3 Specular;
+
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+
+uniform sampler2D gAlbedoSpecular;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+uniform mat4 inverseViewProjection;
+// the part of the G-buffer drawn this frame, from its lower-left corner
+uniform vec2 renderSize;
+uniform float shininess;
+
+// one point light of the deferred renderer, same as CalcPointLight in lighting.fs, added on top
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    vec4 position = inverseViewProjection * vec4(gl_FragCoord.xy / renderSize * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+    vec3 fragPos = position.xyz / position.w;
+
+    float distance = length(PositionRadius.xyz - fragPos);
+    if (distance > PositionRadius.w)
+        discard;
+
+    vec4 albedoSpecular = texelFetch(gAlbedoSpecular, pixel, 0);
+    vec3 normal = texelFetch(gNormal, pixel, 0).xyz;
+    vec3 viewDir = normalize(viewPosition - fragPos);
+    vec3 lightDir = normalize(PositionRadius.xyz - fragPos);
+    float diff = max(dot(normal, lightDir), 0.0);
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+    float attenuation = 1.0 / (Attenuation.x + Attenuation.y * distance + Attenuation.z * (distance * distance));
+
+    vec3 ambient = Ambient * albedoSpecular.rgb;
+    vec3 diffuse = Diffuse * diff * albedoSpecular.rgb;
+    vec3 specular = Specular * spec * albedoSpecular.a;
+    FragColor = vec4((ambient + diffuse + specular) * attenuation, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+// per light
+layout (location = 1) in vec4 aPositionRadius;
+layout (location = 2) in vec3 aAttenuation; // constant, linear, quadratic
+layout (location = 3) in vec3 aAmbient;
+layout (location = 4) in vec3 aDiffuse;
+layout (location = 5) in vec3 aSpecular;
+
+flat out vec4 PositionRadius;
+flat out vec3 Attenuation;
+flat out vec3 Ambient;
+flat out vec3 Diffuse;
+flat out vec3 Specular;
+
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+
+// the light volume, a unit sphere scaled to the distance at which the light fades out
+void main()
+{
+    PositionRadius = aPositionRadius;
+    Attenuation = aAttenuation;
+    Ambient = aAmbient;
+    Diffuse = aDiffuse;
+    Specular = aSpecular;
+    gl_Position = projection * view * vec4(aPositionRadius.xyz + aPos * aPositionRadius.w, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#version 330 core
+// GL 4.3 features, GLExtensions only enables multi draw indirect where the driver has them
+#extension GL_ARB_shader_storage_buffer_object : require
+#extension GL_ARB_shading_language_420pack : require
+layout (location = 0) in vec3 aPos;
+layout (location = 5) in uint aDrawID;
+
+struct DrawData {
+    mat4 model;
+    uvec4 material;
+};
+
+layout (std430, binding = 0) readonly buffer DrawBuffer {
+    DrawData draws[];
+};
+
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+
+// must match lighting_mdi.vs exactly, the colour pass tests against this depth with GL_EQUAL
+invariant gl_Position;
+
+void main()
+{
+    vec3 FragPos = vec3(draws[aDrawID].model * vec4(aPos, 1.0));
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
\ No newline at end of file
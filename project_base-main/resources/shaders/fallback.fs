@@ -0,0 +1,11 @@
+#version 330 core
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out vec4 FragNormal;
+
+// stands in for a shader variant that is still compiling, see ShaderVariants; the second output
+// keeps the G-buffer's normal sensible when it replaces a geometry pass shader
+void main()
+{
+    FragColor = vec4(0.5, 0.5, 0.5, 1.0);
+    FragNormal = vec4(0.0, 1.0, 0.0, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#version 330 core
+layout (location = 0) out vec4 gAlbedoSpecular;
+layout (location = 1) out vec4 gNormal;
+
+struct Material {
+    sampler2D texture_diffuse1;
+    sampler2D texture_specular1;
+
+    float shininess;
+};
+in vec2 TexCoords;
+in vec3 Normal;
+in vec3 FragPos;
+
+uniform Material material;
+
+// geometry pass of the deferred renderer, writes what lighting.fs would light
+void main()
+{
+    gAlbedoSpecular.rgb = texture(material.texture_diffuse1, TexCoords).rgb;
+#ifdef HAS_SPECULAR_MAP
+    gAlbedoSpecular.a = texture(material.texture_specular1, TexCoords).r;
+#else
+    gAlbedoSpecular.a = 0.0;
+#endif
+    gNormal = vec4(normalize(Normal), 1.0);
+}
\ No newline at end of file
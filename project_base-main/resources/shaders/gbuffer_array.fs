@@ -0,0 +1,27 @@
+#version 330 core
+layout (location = 0) out vec4 gAlbedoSpecular;
+layout (location = 1) out vec4 gNormal;
+
+// the textures of every draw are layers of these arrays, see TextureArrays
+struct Material {
+    sampler2DArray texture_diffuse1;
+    sampler2DArray texture_specular1;
+
+    float shininess;
+};
+in vec2 TexCoords;
+in vec3 Normal;
+in vec3 FragPos;
+flat in uvec2 Layers; // diffuse, specular
+
+uniform Material material;
+
+const uint NO_LAYER = 0xFFFFFFFFu;
+
+// geometry pass of the deferred renderer, writes what lighting_array.fs would light
+void main()
+{
+    gAlbedoSpecular.rgb = texture(material.texture_diffuse1, vec3(TexCoords, Layers.x)).rgb;
+    gAlbedoSpecular.a = Layers.y == NO_LAYER ? 0.0 : texture(material.texture_specular1, vec3(TexCoords, Layers.y)).r;
+    gNormal = vec4(normalize(Normal), 1.0);
+}
\ No newline at end of file
@@ -3,14 +3,12 @@ out vec4 FragColor;
 
 struct PointLight {
     vec3 position;
-
-    vec3 specular;
-    vec3 diffuse;
-    vec3 ambient;
-
     float constant;
+    vec3 ambient;
     float linear;
+    vec3 diffuse;
     float quadratic;
+    vec3 specular;
 };
 
 struct DirLight {
@@ -31,16 +29,55 @@ in vec2 TexCoords;
 in vec3 Normal;
 in vec3 FragPos;
 
-uniform PointLight pointLight1; // oil lamp
-uniform PointLight pointLight2;
-uniform PointLight pointLight3; // treasure
-uniform PointLight pointLight4;
-uniform PointLight pointLight5; // house
-uniform PointLight pointLight6; // fire
-uniform DirLight dirLight;
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+layout (std140) uniform Lights {
+    DirLight dirLight;
+    PointLight pointLights[6]; // 0, 1 oil lamps, 2, 3 treasure, 4 house, 5 fire
+};
 uniform Material material;
+// the material is sampled once in main, derivatives are undefined inside the light loop
+vec3 diffuseColor;
+vec3 specularColor;
+
+// point lights of the pixel's cluster, see ClusteredLights
+layout (std140) uniform Clusters {
+    uvec4 clusterGrid;  // clusters along x, y and depth, first texel of this frame's clusterRanges; 0 without lists
+    vec4 clusterScale;  // clusters per pixel along x and y, depth slices per log(depth), log(near) * slices per log(depth)
+};
+uniform samplerBuffer clusterLights;        // 4 texels per PointLight
+uniform usamplerBuffer clusterRanges;       // first texel, count in clusterLightIndices
+uniform usamplerBuffer clusterLightIndices;
+
+PointLight clusterLight(uint index)
+{
+    int texel = int(index) * 4;
+    vec4 positionConstant = texelFetch(clusterLights, texel);
+    vec4 ambientLinear = texelFetch(clusterLights, texel + 1);
+    vec4 diffuseQuadratic = texelFetch(clusterLights, texel + 2);
+    PointLight light;
+    light.position = positionConstant.xyz;
+    light.constant = positionConstant.w;
+    light.ambient = ambientLinear.xyz;
+    light.linear = ambientLinear.w;
+    light.diffuse = diffuseQuadratic.xyz;
+    light.quadratic = diffuseQuadratic.w;
+    light.specular = texelFetch(clusterLights, texel + 3).xyz;
+    return light;
+}
+uvec2 clusterRange(vec3 fragPos)
+{
+    if (clusterGrid.x == 0u)
+        return uvec2(0u);
+    float depth = -(view * vec4(fragPos, 1.0)).z;
+    uvec2 tile = min(uvec2(gl_FragCoord.xy * clusterScale.xy), clusterGrid.xy - 1u);
+    uint slice = uint(clamp(log(depth) * clusterScale.z - clusterScale.w, 0.0, float(clusterGrid.z - 1u)));
+    return texelFetch(clusterRanges, int(clusterGrid.w + (slice * clusterGrid.y + tile.y) * clusterGrid.x + tile.x)).xy;
+}
 
-uniform vec3 viewPosition;
 // calculates the color when using a point light.
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
 {
@@ -54,9 +91,9 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float distance = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, TexCoords).xxx);
+    vec3 ambient = light.ambient * diffuseColor;
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+    vec3 specular = light.specular * spec * specularColor.xxx;
     ambient *= attenuation;
     diffuse *= attenuation;
     specular *= attenuation;
@@ -73,21 +110,24 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
 //     vec3 reflectDir = reflect(-lightDir, normal);
 //     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, TexCoords));
+    vec3 ambient = light.ambient * diffuseColor;
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+    vec3 specular = light.specular * spec * specularColor;
     return (ambient + diffuse + specular);
 }
 void main()
 {
     vec3 normal = normalize(Normal);
     vec3 viewDir = normalize(viewPosition - FragPos);
-    vec3 result = CalcPointLight(pointLight1, normal, FragPos, viewDir) +
-                    CalcPointLight(pointLight2, normal, FragPos, viewDir) +
-                    CalcPointLight(pointLight3, normal, FragPos, viewDir) +
-                    CalcPointLight(pointLight4, normal, FragPos, viewDir) +
-                    CalcPointLight(pointLight5, normal, FragPos, viewDir) +
-                    CalcPointLight(pointLight6, normal, FragPos, viewDir) +
-                    CalcDirLight(dirLight, normal, viewDir);
+    diffuseColor = vec3(texture(material.texture_diffuse1, TexCoords));
+#ifdef HAS_SPECULAR_MAP
+    specularColor = vec3(texture(material.texture_specular1, TexCoords));
+#else
+    specularColor = vec3(0.0);
+#endif
+    vec3 result = CalcDirLight(dirLight, normal, viewDir);
+    uvec2 range = clusterRange(FragPos);
+    for (uint i = 0u; i < range.y; i++)
+        result += CalcPointLight(clusterLight(texelFetch(clusterLightIndices, int(range.x + i)).r), normal, FragPos, viewDir);
     FragColor = vec4(result, 1.0);
 }
\ No newline at end of file
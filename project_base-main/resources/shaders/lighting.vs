@@ -7,14 +7,22 @@ out vec2 TexCoords;
 out vec3 Normal;
 out vec3 FragPos;
 
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+// the depth pre-pass (depth.vs) computes the same position, this keeps GL_EQUAL depth tests exact
+invariant gl_Position;
 
 void main()
 {
     FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = aNormal;
+    // world space like the static batches, which have their transforms baked into the vertices
+    Normal = transpose(inverse(mat3(model))) * aNormal;
     TexCoords = aTexCoords;    
     gl_Position = projection * view * vec4(FragPos, 1.0);
 }
\ No newline at end of file
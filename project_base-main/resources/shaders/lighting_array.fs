@@ -0,0 +1,144 @@
+#version 330 core
+out vec4 FragColor;
+
+struct PointLight {
+    vec3 position;
+    float constant;
+    vec3 ambient;
+    float linear;
+    vec3 diffuse;
+    float quadratic;
+    vec3 specular;
+};
+
+struct DirLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// the textures of every draw are layers of these arrays, see TextureArrays
+struct Material {
+    sampler2DArray texture_diffuse1;
+    sampler2DArray texture_specular1;
+
+    float shininess;
+};
+in vec2 TexCoords;
+in vec3 Normal;
+in vec3 FragPos;
+flat in uvec2 Layers; // diffuse, specular
+
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+layout (std140) uniform Lights {
+    DirLight dirLight;
+    PointLight pointLights[6]; // 0, 1 oil lamps, 2, 3 treasure, 4 house, 5 fire
+};
+uniform Material material;
+
+// point lights of the pixel's cluster, see ClusteredLights
+layout (std140) uniform Clusters {
+    uvec4 clusterGrid;  // clusters along x, y and depth, first texel of this frame's clusterRanges; 0 without lists
+    vec4 clusterScale;  // clusters per pixel along x and y, depth slices per log(depth), log(near) * slices per log(depth)
+};
+uniform samplerBuffer clusterLights;        // 4 texels per PointLight
+uniform usamplerBuffer clusterRanges;       // first texel, count in clusterLightIndices
+uniform usamplerBuffer clusterLightIndices;
+
+PointLight clusterLight(uint index)
+{
+    int texel = int(index) * 4;
+    vec4 positionConstant = texelFetch(clusterLights, texel);
+    vec4 ambientLinear = texelFetch(clusterLights, texel + 1);
+    vec4 diffuseQuadratic = texelFetch(clusterLights, texel + 2);
+    PointLight light;
+    light.position = positionConstant.xyz;
+    light.constant = positionConstant.w;
+    light.ambient = ambientLinear.xyz;
+    light.linear = ambientLinear.w;
+    light.diffuse = diffuseQuadratic.xyz;
+    light.quadratic = diffuseQuadratic.w;
+    light.specular = texelFetch(clusterLights, texel + 3).xyz;
+    return light;
+}
+uvec2 clusterRange(vec3 fragPos)
+{
+    if (clusterGrid.x == 0u)
+        return uvec2(0u);
+    float depth = -(view * vec4(fragPos, 1.0)).z;
+    uvec2 tile = min(uvec2(gl_FragCoord.xy * clusterScale.xy), clusterGrid.xy - 1u);
+    uint slice = uint(clamp(log(depth) * clusterScale.z - clusterScale.w, 0.0, float(clusterGrid.z - 1u)));
+    return texelFetch(clusterRanges, int(clusterGrid.w + (slice * clusterGrid.y + tile.y) * clusterGrid.x + tile.x)).xy;
+}
+
+const uint NO_LAYER = 0xFFFFFFFFu;
+// the material is sampled once in main, derivatives are undefined inside the light loop
+vec3 diffuseColor;
+vec3 specularColor;
+
+vec3 sampleDiffuse()
+{
+    return vec3(texture(material.texture_diffuse1, vec3(TexCoords, Layers.x)));
+}
+vec3 sampleSpecular()
+{
+    if (Layers.y == NO_LAYER)
+        return vec3(0.0);
+    return vec3(texture(material.texture_specular1, vec3(TexCoords, Layers.y)));
+}
+
+// calculates the color when using a point light.
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    // attenuation
+    float distance = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    // combine results
+    vec3 ambient = light.ambient * diffuseColor;
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+    vec3 specular = light.specular * spec * specularColor.xxx;
+    ambient *= attenuation;
+    diffuse *= attenuation;
+    specular *= attenuation;
+    return (ambient + diffuse + specular);
+}
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
+{
+    vec3 lightDir = normalize(-light.direction);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), 32.0);
+//     vec3 reflectDir = reflect(-lightDir, normal);
+//     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    // combine results
+    vec3 ambient = light.ambient * diffuseColor;
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+    vec3 specular = light.specular * spec * specularColor;
+    return (ambient + diffuse + specular);
+}
+void main()
+{
+    vec3 normal = normalize(Normal);
+    vec3 viewDir = normalize(viewPosition - FragPos);
+    diffuseColor = sampleDiffuse();
+    specularColor = sampleSpecular();
+    vec3 result = CalcDirLight(dirLight, normal, viewDir);
+    uvec2 range = clusterRange(FragPos);
+    for (uint i = 0u; i < range.y; i++)
+        result += CalcPointLight(clusterLight(texelFetch(clusterLightIndices, int(range.x + i)).r), normal, FragPos, viewDir);
+    FragColor = vec4(result, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#version 330 core
+// GL 4.3 features, GLExtensions only enables multi draw indirect where the driver has them
+#extension GL_ARB_shader_storage_buffer_object : require
+#extension GL_ARB_shading_language_420pack : require
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 5) in uint aDrawID;
+
+out vec2 TexCoords;
+out vec3 Normal;
+out vec3 FragPos;
+flat out uvec2 Layers;
+
+struct DrawData {
+    mat4 model;
+    uvec4 material;
+};
+
+layout (std430, binding = 0) readonly buffer DrawBuffer {
+    DrawData draws[];
+};
+
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+
+// the depth pre-pass (depth_mdi.vs) computes the same position, this keeps GL_EQUAL depth tests exact
+invariant gl_Position;
+
+void main()
+{
+    FragPos = vec3(draws[aDrawID].model * vec4(aPos, 1.0));
+    // world space like the static batches, which have their transforms baked into the vertices
+    Normal = transpose(inverse(mat3(draws[aDrawID].model))) * aNormal;
+    TexCoords = aTexCoords;
+    Layers = draws[aDrawID].material.xy;
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
\ No newline at end of file
@@ -11,14 +11,12 @@ struct DirLight {
 
 struct PointLight {
     vec3 position;
-
-    vec3 specular;
-    vec3 diffuse;
-    vec3 ambient;
-
     float constant;
+    vec3 ambient;
     float linear;
+    vec3 diffuse;
     float quadratic;
+    vec3 specular;
 };
 
 in VS_OUT {
@@ -35,9 +33,10 @@ in VS_OUT {
 uniform sampler2D diffuseMap;
 uniform sampler2D normalMap;
 uniform sampler2D depthMap;
-uniform DirLight dirLight;
-uniform PointLight pointLight1;
-uniform PointLight pointLight2;
+layout (std140) uniform Lights {
+    DirLight dirLight;
+    PointLight pointLights[6]; // 0, 1 oil lamps, 2, 3 treasure, 4 house, 5 fire
+};
 uniform float heightScale;
 //uniform vec3 lightPos;
 //uniform vec3 viewPos;
@@ -141,18 +140,20 @@ void main()
    vec3 viewDir2 = normalize(fs_in.TangentViewPos2 - fs_in.TangentFragPos2);
 
    vec2 texCoords1 = fs_in.TexCoords;
+   vec2 texCoords2 = fs_in.TexCoords;
+#ifdef PARALLAX
        texCoords1 = ParallaxMapping(fs_in.TexCoords,  viewDir1);
        if(texCoords1.x > 7.5 || texCoords1.y > 7.5 || texCoords1.x < 0.0 || texCoords1.y < 0.0)
            discard;
 
-   vec2 texCoords2 = fs_in.TexCoords;
           texCoords2 = ParallaxMapping(fs_in.TexCoords,  viewDir2);
           if(texCoords2.x > 7.5 || texCoords2.y > 7.5 || texCoords2.x < 0.0 || texCoords2.y < 0.0)
               discard;
+#endif
 
    vec3 result = CalcDirLight(dirLight, normal, viewDir1, texCoords1) +
-                    CalcPointLight1(pointLight1, normal, viewDir1, texCoords1) +
-                    CalcPointLight2(pointLight2, normal, viewDir2, texCoords2);
+                    CalcPointLight1(pointLights[0], normal, viewDir1, texCoords1) +
+                    CalcPointLight2(pointLights[1], normal, viewDir2, texCoords2);
 
    FragColor = vec4(result, 1.0);
 }
\ No newline at end of file
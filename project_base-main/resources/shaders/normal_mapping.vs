@@ -16,13 +16,35 @@ out VS_OUT {
     vec3 TangentFragPos2;
 } vs_out;
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
+struct DirLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct PointLight {
+    vec3 position;
+    float constant;
+    vec3 ambient;
+    float linear;
+    vec3 diffuse;
+    float quadratic;
+    vec3 specular;
+};
 
-uniform vec3 lightPos1;
-uniform vec3 lightPos2;
-uniform vec3 viewPos;
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+layout (std140) uniform Lights {
+    DirLight dirLight;
+    PointLight pointLights[6]; // 0, 1 oil lamps, 2, 3 treasure, 4 house, 5 fire
+};
+
+uniform mat4 model;
 
 void main()
 {
@@ -36,13 +58,13 @@ void main()
     vec3 B = cross(N, T);
     
     mat3 TBN1 = transpose(mat3(T, B, N));
-    vs_out.TangentLightPos1 = TBN1 * lightPos1;
-    vs_out.TangentViewPos1  = TBN1 * viewPos;
+    vs_out.TangentLightPos1 = TBN1 * pointLights[0].position;
+    vs_out.TangentViewPos1  = TBN1 * viewPosition;
     vs_out.TangentFragPos1  = TBN1 * vs_out.FragPos;
 
     mat3 TBN2 = transpose(mat3(T, B, N));
-    vs_out.TangentLightPos2 = TBN2 * lightPos2;
-    vs_out.TangentViewPos2  = TBN2 * viewPos;
+    vs_out.TangentLightPos2 = TBN2 * pointLights[1].position;
+    vs_out.TangentViewPos2  = TBN2 * viewPosition;
     vs_out.TangentFragPos2  = TBN2 * vs_out.FragPos;
         
     gl_Position = projection * view * model * vec4(aPos, 1.0);
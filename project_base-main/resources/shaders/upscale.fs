@@ -0,0 +1,35 @@
+#version 330 core
+out vec4 FragColor;
+
+uniform sampler2D scene;
+// part of the scene texture the frame was drawn into and the size of the window, in pixels
+uniform vec2 renderSize;
+uniform vec2 outputSize;
+uniform float sharpness;
+
+// bilinear sample at a position in texels, kept inside the drawn part; the texels around it are
+// left over from frames drawn bigger
+vec3 sampleScene(vec2 position)
+{
+    position = clamp(position, vec2(0.5), renderSize - 0.5);
+    return texture(scene, position / vec2(textureSize(scene, 0))).rgb;
+}
+
+// stretches the scene over the window, see SceneTarget
+void main()
+{
+    vec2 position = gl_FragCoord.xy / outputSize * renderSize;
+    vec3 color = sampleScene(position);
+    if (sharpness > 0.0) {
+        // unsharp mask over the four neighbours, limited to their range so edges do not ring
+        vec3 north = sampleScene(position + vec2(0.0, 1.0));
+        vec3 south = sampleScene(position - vec2(0.0, 1.0));
+        vec3 east = sampleScene(position + vec2(1.0, 0.0));
+        vec3 west = sampleScene(position - vec2(1.0, 0.0));
+        vec3 blurred = (north + south + east + west) * 0.25;
+        vec3 lowest = min(min(min(north, south), min(east, west)), color);
+        vec3 highest = max(max(max(north, south), max(east, west)), color);
+        color = clamp(color + (color - blurred) * sharpness, lowest, highest);
+    }
+    FragColor = vec4(color, 1.0);
+}
\ No newline at end of file
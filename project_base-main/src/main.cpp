@@ -9,17 +9,51 @@
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
-
+#include <rg/GLExtensions.h>
+#include <rg/FramePacer.h>
+#include <rg/FrameTimeGovernor.h>
+#include <rg/FrameTimes.h>
+#include <rg/Flythrough.h>
+#include <rg/BenchmarkReport.h>
+#include <rg/ClusteredLights.h>
+#include <rg/CpuProfiler.h>
+#include <rg/DeferredRenderer.h>
+#include <rg/GLStateCache.h>
+#include <rg/GpuProfiler.h>
+#include <rg/GpuTimer.h>
+#include <rg/HeadlessContext.h>
+#include <rg/HotReload.h>
+#include <rg/OcclusionCuller.h>
+#include <rg/PerformanceOverlay.h>
+#include <rg/RenderStats.h>
+#include <rg/SceneTarget.h>
+#include <rg/ShaderManager.h>
+#include <rg/ShaderVariants.h>
+#include <rg/Simulation.h>
+#include <rg/StaticBatches.h>
+#include <rg/StaticDrawList.h>
+#include <rg/StreamBuffer.h>
+#include <rg/ThreadPool.h>
+#include <rg/UniformBuffers.h>
+#include <rg/UniformBenchmark.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 void mouse_callback(GLFWwindow *window, double xpos, double ypos);
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
+void window_refresh_callback(GLFWwindow *window);
 unsigned int loadTexture(char const * path);
 unsigned int loadCubemap(vector<std::string> faces);
 void renderQuad();
+bool hasArgument(int argc, char *argv[], const char *name);
+const char *argumentValue(int argc, char *argv[], const char *name);
 
 // settings
 const unsigned int SCR_WIDTH = 1200;
@@ -31,32 +65,16 @@ float lastX = SCR_WIDTH / 2.0f;
 float lastY = SCR_HEIGHT / 2.0f;
 bool firstMouse = false;
 
-// timing
-float deltaTime = 0.0f;
-float lastFrame = 0.0f;
-
 bool dayNnite = true; // day is true
+bool occlusionCulling = true;
+bool depthPrepass = false;
+bool deferredShading = false;
+bool staticBatching = true;
+bool dynamicResolution = true;
+bool printFrameStats = false;
+bool showPerformanceOverlay = false;
 float heightScale = 0.0;
 
-struct PointLight {
-    glm::vec3 position;
-    glm::vec3 ambient;
-    glm::vec3 diffuse;
-    glm::vec3 specular;
-
-    float constant;
-    float linear;
-    float quadratic;
-};
-
-struct DirLight {
-    glm::vec3 direction;
-
-    glm::vec3 ambient;
-    glm::vec3 diffuse;
-    glm::vec3 specular;
-};
-
 struct ProgramState {
     glm::vec3 clearColor = glm::vec3(0);
     Camera camera;
@@ -102,45 +120,154 @@ void ProgramState::LoadFromFile(std::string filename) {
 
 ProgramState *programState;
 
-void lightIt(Shader shader, PointLight pointLight1, PointLight pointLight2, PointLight pointLight3, PointLight pointLight4, PointLight pointLight5, PointLight pointLight6);
-void lightDirLight(Shader shader, DirLight dirLightDay, DirLight dirLightNight);
-void lightPointNormal(Shader shader, PointLight pointLight1, PointLight pointLight2);
+// camera movement and the parallax height run on the simulation thread at a fixed rate
+const double SIMULATION_TICK_RATE = 120.0;
+// height scale change per second while Q or E is held
+const float HEIGHT_SCALE_SPEED = 0.3f;
+
+enum SimulationAction : unsigned int {
+    MOVE_FORWARD = 1 << 0,
+    MOVE_BACKWARD = 1 << 1,
+    MOVE_LEFT = 1 << 2,
+    MOVE_RIGHT = 1 << 3,
+    LOWER_HEIGHT_SCALE = 1 << 4,
+    RAISE_HEIGHT_SCALE = 1 << 5
+};
+
+// what the renderer needs of the simulated state, published after every tick
+struct SimulationSnapshot {
+    glm::vec3 cameraPosition;
+    glm::vec3 cameraFront;
+    glm::vec3 cameraUp;
+    float zoom;
+    float heightScale;
+
+    static SimulationSnapshot interpolate(const SimulationSnapshot &a, const SimulationSnapshot &b, float t) {
+        SimulationSnapshot result;
+        result.cameraPosition = glm::mix(a.cameraPosition, b.cameraPosition, t);
+        result.cameraFront = glm::normalize(glm::mix(a.cameraFront, b.cameraFront, t));
+        result.cameraUp = glm::normalize(glm::mix(a.cameraUp, b.cameraUp, t));
+        result.zoom = glm::mix(a.zoom, b.zoom, t);
+        result.heightScale = glm::mix(a.heightScale, b.heightScale, t);
+        return result;
+    }
 
+    bool operator==(const SimulationSnapshot &other) const {
+        return cameraPosition == other.cameraPosition && cameraFront == other.cameraFront && cameraUp == other.cameraUp
+               && zoom == other.zoom && heightScale == other.heightScale;
+    }
+};
 
-int main() {
-    // glfw: initialize and configure
-    // ------------------------------
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+SimulationInput simulationInput;
+FramePacer framePacer;
+
+// frames --headless and --benchmark draw before they start timing, the first ones compile shaders
+// and fill caches
+const unsigned int WARM_UP_FRAMES = 10;
+// seconds of the path a --benchmark frame moves the camera on, however long the frame took
+const float BENCHMARK_STEP = 1.0f / 60.0f;
+
+// --record-path: K adds the camera as the next key, L presses after the first key are kept too
+const char *recordedPathFile = nullptr;
+Flythrough recordedPath;
+bool addPathKey = false;
+double pathRecordStart = 0.0;
+
+// frames T captures into the next trace_<n>.json
+const unsigned int TRACE_FRAMES = 120;
+unsigned int traceCount = 0;
+
+void simulate(float step);
+SimulationSnapshot captureSimulation();
+
+
+int main(int argc, char *argv[]) {
+    // everything up to the end of the first frame: window, shaders, models, textures
+    cpuProfiler().nameThread("main");
+    if (const char *path = argumentValue(argc, argv, "--trace-startup"))
+        cpuProfiler().capture(1, path);
+
+    // headless: no window, a surfaceless EGL context drawing a fixed number of frames into a
+    // framebuffer object, for machines without a display or a GPU
+    const bool headless = hasArgument(argc, argv, "--headless");
+    int headlessWidth = SCR_WIDTH, headlessHeight = SCR_HEIGHT;
+    if (const char *size = argumentValue(argc, argv, "--size"))
+        std::sscanf(size, "%dx%d", &headlessWidth, &headlessHeight);
+    const char *headlessFrameCount = argumentValue(argc, argv, "--frames");
+    const unsigned int headlessFrames = headlessFrameCount ? std::atoi(headlessFrameCount) : 300;
+    HeadlessContext headlessContext;
+    // glfw: terminate on every way out of main, declared before the GL objects below so they are
+    // destroyed while the window's context is still current
+    struct GlfwTerminate {
+        ~GlfwTerminate() { glfwTerminate(); }
+    } glfwTerminateOnExit;
+    GLFWwindow *window = nullptr;
+
+    // benchmark: the camera flies a path at a fixed step per frame, the same frames every run, with
+    // the frame times summed up at the end and optionally held against a baseline report
+    const char *benchmarkPath = argumentValue(argc, argv, "--benchmark");
+    Flythrough flythrough;
+    if (benchmarkPath && !flythrough.load(benchmarkPath))
+        return -1;
+    recordedPathFile = argumentValue(argc, argv, "--record-path");
+
+    if (headless) {
+        if (headlessWidth <= 0 || headlessHeight <= 0 || !headlessContext.create(headlessWidth, headlessHeight))
+            return -1;
+        glExtensions().load(HeadlessContext::loader());
+    } else {
+        // glfw: initialize and configure
+        // ------------------------------
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 #ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-    // glfw window creation
-    // --------------------
-    GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Pirates", NULL, NULL);
-    if (window == NULL) {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
-    }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
-    glfwSetKeyCallback(window, key_callback);
-    // tell GLFW to capture our mouse
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-    // glad: load all OpenGL function pointers
-    // ---------------------------------------
-    if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
+        // glfw window creation
+        // --------------------
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Pirates", NULL, NULL);
+        if (window == NULL) {
+            std::cout << "Failed to create GLFW window" << std::endl;
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetScrollCallback(window, scroll_callback);
+        glfwSetKeyCallback(window, key_callback);
+        glfwSetWindowRefreshCallback(window, window_refresh_callback);
+        // tell GLFW to capture our mouse
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+        // glad: load all OpenGL function pointers
+        // ---------------------------------------
+        if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return -1;
+        }
+        glExtensions().load((GLADloadproc) glfwGetProcAddress);
+        if (const char *fps = argumentValue(argc, argv, "--fps-limit")) {
+            framePacer.setTargetFps(std::atof(fps));
+            framePacer.setMode(FramePacer::LIMITED);
+        } else if (benchmarkPath) {
+            // as fast as it goes, vsync would hold every frame to the refresh rate
+            framePacer.setTargetFps(1.0e4);
+            framePacer.setMode(FramePacer::LIMITED);
+        } else {
+            framePacer.setMode(hasArgument(argc, argv, "--render-on-demand") ? FramePacer::ON_DEMAND : FramePacer::VSYNC);
+        }
     }
+    // where a frame ends up, the window's framebuffer or the headless target
+    const unsigned int outputFramebuffer = headlessContext.framebuffer();
+    programBinaryCache().enabled = !hasArgument(argc, argv, "--no-shader-cache");
+    if (const char *path = argumentValue(argc, argv, "--present-log"))
+        framePacer.logPresents(path);
+    if (const char *path = argumentValue(argc, argv, "--stats-log"))
+        renderStats().logFrames(path);
 
 
     // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
@@ -151,19 +278,61 @@ int main() {
 
     // configure global opengl state
     // -----------------------------
-    glEnable(GL_DEPTH_TEST);
+    glState().setEnabled(GL_DEPTH_TEST, true);
 
     // Face culling
-    glCullFace(GL_FRONT);
+    glState().cullFace(GL_FRONT);
 
 
     // build and compile shaders
     // -------------------------
-    Shader lightingShader("resources/shaders/lighting.vs", "resources/shaders/lighting.fs");
+    // the model shaders come in variants, each mesh picks the one its material needs
+    ShaderVariants lightingVariants("resources/shaders/lighting.vs", "resources/shaders/lighting.fs",
+                                    ShaderVariants::HAS_SPECULAR_MAP, [](Shader &shader) {
+        bindSceneUniformBlocks(shader);
+        ClusteredLights::setupShader(shader);
+        // the flag and the water bind their textures by hand on the material units
+        shader.setInt("material.texture_diffuse1", Material::DIFFUSE);
+        shader.setInt("material.texture_specular1", Material::SPECULAR);
+        shader.setFloat("material.shininess", 32.0f);
+    });
+    ShaderVariants gBufferVariants("resources/shaders/lighting.vs", "resources/shaders/gbuffer.fs",
+                                   ShaderVariants::HAS_SPECULAR_MAP, [](Shader &shader) {
+        bindSceneUniformBlocks(shader);
+        shader.use();
+        shader.setInt("material.texture_diffuse1", Material::DIFFUSE);
+        shader.setInt("material.texture_specular1", Material::SPECULAR);
+    });
+    ShaderVariants normalMappingVariants("resources/shaders/normal_mapping.vs", "resources/shaders/normal_mapping.fs",
+                                         ShaderVariants::PARALLAX, [](Shader &shader) {
+        bindSceneUniformBlocks(shader);
+        shader.use();
+        shader.setInt("diffuseMap", 0);
+        shader.setInt("normalMap", 1);
+        shader.setInt("depthMap", 2);
+    });
+    // every variant goes to the driver now and compiles while the models load
+    ShaderManager shaderManager({&lightingVariants, &gBufferVariants, &normalMappingVariants});
+    shaderManager.submitAll();
     Shader skyboxShader("resources/shaders/skybox.vs", "resources/shaders/skybox.fs");
-    Shader blendingShader("resources/shaders/blending.vs", "resources/shaders/blending.fs");
+    // the grass texture is cut out, so grass always needs the alpha test
+    Shader blendingShader("resources/shaders/blending.vs", "resources/shaders/blending.fs",
+                          ShaderVariants::defines(ShaderVariants::ALPHA_TEST));
     Shader lightCubeShader("resources/shaders/lightCube.vs", "resources/shaders/lightCube.fs");
-    Shader normalMappingShader("resources/shaders/normal_mapping.vs", "resources/shaders/normal_mapping.fs");
+    Shader depthShader("resources/shaders/depth.vs", "resources/shaders/depth.fs");
+    Shader deferredDirectionalShader("resources/shaders/deferred_directional.vs", "resources/shaders/deferred_directional.fs");
+    Shader deferredPointShader("resources/shaders/deferred_point.vs", "resources/shaders/deferred_point.fs");
+    Shader upscaleShader("resources/shaders/deferred_directional.vs", "resources/shaders/upscale.fs");
+    // lighting shader that reads its model matrices and texture layers from a storage buffer, needs GL 4.3 or its extensions
+    std::unique_ptr<Shader> lightingMultiDrawShader;
+    if (glExtensions().multiDrawIndirect)
+        lightingMultiDrawShader = std::make_unique<Shader>("resources/shaders/lighting_mdi.vs", "resources/shaders/lighting_array.fs");
+    std::unique_ptr<Shader> depthMultiDrawShader;
+    std::unique_ptr<Shader> gBufferMultiDrawShader;
+    if (glExtensions().multiDrawIndirect) {
+        depthMultiDrawShader = std::make_unique<Shader>("resources/shaders/depth_mdi.vs", "resources/shaders/depth.fs");
+        gBufferMultiDrawShader = std::make_unique<Shader>("resources/shaders/lighting_mdi.vs", "resources/shaders/gbuffer_array.fs");
+    }
 
     // load models
     // -----------
@@ -204,6 +373,151 @@ int main() {
     Model campfire("resources/objects/campfire/Campfire.obj");
     campfire.SetShaderTextureNamePrefix("material.");
 
+    // workers for the cluster light lists and for recording the per mesh static draws
+    ThreadPool threadPool;
+    // static models are packed into shared buffers for multi draw indirect
+    StaticDrawList staticDrawList(lightingMultiDrawShader.get(), threadPool);
+    // and merged in world space, by material and grid cell, for static batching
+    StaticBatches staticBatches;
+    auto addStaticProp = [&](Model &object, const glm::mat4 &transform) {
+        staticDrawList.add(object, transform);
+        staticBatches.add(object, transform);
+    };
+    glm::mat4 model;
+    // pirateship
+    model = glm::mat4(1.0f); // initialization
+    model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
+    model = glm::scale(model, glm::vec3(1.2f, 1.2f, 1.2f));
+    addStaticProp(pirateShip, model);
+
+    // pirate
+    model = glm::mat4(1.0f); // initialization
+    model = glm:: translate(model, glm::vec3(0.5f, 6.72f, -10.6f));
+    model = glm::rotate(model, glm::radians(270.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    model = glm::scale(model, glm::vec3(0.017f, 0.017f, 0.017f));
+    addStaticProp(pirate, model);
+
+    // pirate2
+    model = glm::mat4(1.0f); // initialization
+    model = glm:: translate(model, glm::vec3(3.2f, 3.81f, -3.6f));
+    model = glm::rotate(model, glm::radians(270.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    model = glm::scale(model, glm::vec3(0.04f, 0.04f, 0.04f));
+    addStaticProp(pirate2, model);
+
+    // cannon
+    model = glm::mat4(1.0f); // initialization
+    model = glm:: translate(model, glm::vec3(1.9f, 3.81f, 2.7f));
+    model = glm::rotate(model, glm::radians(270.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    model = glm::rotate(model, glm::radians(-28.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    model = glm::scale(model, glm::vec3(0.022f, 0.022f, 0.022f));
+    addStaticProp(cannon, model);
+    model = glm::mat4(1.0f); // initialization
+    model = glm:: translate(model, glm::vec3(-1.9f, 3.81f, 2.7f));
+    model = glm::rotate(model, glm::radians(270.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    model = glm::rotate(model, glm::radians(-150.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    model = glm::scale(model, glm::vec3(0.022f, 0.022f, 0.022f));
+    addStaticProp(cannon, model);
+
+    // treasure
+    model = glm::mat4(1.0f); // initialization
+    model = glm:: translate(model, glm::vec3(-3.22f, 6.6f, -12.9f));
+    model = glm::rotate(model, glm::radians(270.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    model = glm::scale(model, glm::vec3(0.017f, 0.017f, 0.017f));
+    addStaticProp(treasure, model);
+    model = glm::mat4(1.0f); // initialization
+    model = glm:: translate(model, glm::vec3(3.22f, 6.6f, -12.9f));
+    model = glm::rotate(model, glm::radians(270.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    model = glm::scale(model, glm::vec3(0.017f, 0.017f, 0.017f));
+    addStaticProp(treasure, model);
+
+    // table
+    model = glm::mat4(1.0f); // initialization
+    model = glm:: translate(model, glm::vec3(-35.5f, 20.0f, -105.3f));
+    model = glm::rotate(model, glm::radians(-15.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    model = glm::scale(model, glm::vec3(0.5f, 0.3f, 0.4f));
+    addStaticProp(table, model);
+
+    // +1.5 0 -5.3
+    // zajecarac
+    model = glm::mat4(1.0f); // initialization
+    model = glm:: translate(model, glm::vec3(-33.5f, 22.6f, -104.7f));
+    //model = glm::rotate(model, glm::radians(120.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    model = glm::scale(model, glm::vec3(0.2f, 0.2f, 0.2f));
+    addStaticProp(zajecarac, model);
+    model = glm::mat4(1.0f); // initialization
+    model = glm:: translate(model, glm::vec3(-37.0f, 22.6f, -105.1f));
+    //model = glm::rotate(model, glm::radians(170.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    model = glm::scale(model, glm::vec3(0.2f, 0.2f, 0.2f));
+    addStaticProp(zajecarac, model);
+
+    // chair
+    model = glm::mat4(1.0f); // initialization
+    model = glm:: translate(model, glm::vec3(-38.3f, 20.0f, -103.0f));
+    model = glm::rotate(model, glm::radians(70.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    model = glm::scale(model, glm::vec3(4.0f, 4.0f, 4.0f));
+    addStaticProp(chair, model);
+    model = glm::mat4(1.0f); // initialization
+    model = glm:: translate(model, glm::vec3(-31.2f, 20.0f, -104.7f));
+    //model = glm::rotate(model, glm::radians(165.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    model = glm::scale(model, glm::vec3(4.0f, 4.0f, 4.0f));
+    addStaticProp(chair, model);
+
+    staticDrawList.addModel(pirateShip);
+    staticDrawList.addModel(pirate);
+    staticDrawList.addModel(pirate2);
+    staticDrawList.addModel(cannon);
+    staticDrawList.addModel(treasure);
+    staticDrawList.addModel(table);
+    staticDrawList.addModel(zajecarac);
+    staticDrawList.addModel(chair);
+    staticDrawList.upload();
+    staticBatches.build();
+
+    // edits of the shaders, models and model textures are picked up while the scene runs
+    HotReload hotReload(&staticDrawList, &staticBatches);
+    for (Shader *shader : {&skyboxShader, &blendingShader, &lightCubeShader, &depthShader, &deferredDirectionalShader,
+                           &deferredPointShader, &upscaleShader, lightingMultiDrawShader.get(), depthMultiDrawShader.get(),
+                           gBufferMultiDrawShader.get()})
+        if (shader)
+            hotReload.add(*shader);
+    for (ShaderVariants *variants : {&lightingVariants, &gBufferVariants, &normalMappingVariants})
+        hotReload.add(*variants);
+    for (Model *model : {&pirateShip, &pirate, &pirate2, &cannon, &island, &treasure, &lamp, &nightlamp, &table,
+                         &zajecarac, &chair, &campfire})
+        hotReload.add(*model);
+    std::cout << "hot reload: watching " << hotReload.directoryCount() << " directories" << std::endl;
+
+    // occlusion queries for the expensive models, the proxy boxes are drawn with the light cube shader
+    OcclusionCuller occlusionCuller(lightCubeShader);
+    // GPU time per pass, the opaque models show whether the depth pre-pass pays off for the current view
+    GpuProfiler profiler;
+    // ImGui draws through the window's GLFW backend, headless has no overlay
+    std::unique_ptr<PerformanceOverlay> performanceOverlay;
+    if (window)
+        performanceOverlay.reset(new PerformanceOverlay(window));
+    // GPU time of the whole scene, what the governor keeps under its target by lowering the render
+    // scale, then forcing the depth pre-pass on (level 1) and parallax mapping off (level 2)
+    GpuTimer sceneTimer;
+    FrameTimeGovernor governor;
+    if (const char *milliseconds = argumentValue(argc, argv, "--target-frame-ms"))
+        governor.setTarget(std::atof(milliseconds));
+    SceneTarget sceneTarget(upscaleShader);
+    unsigned int islandOcclusion = occlusionCuller.add(island.boundsMin, island.boundsMax);
+    unsigned int campfireOcclusion = occlusionCuller.add(campfire.boundsMin, campfire.boundsMax);
+    unsigned int lampOcclusion[3];
+    for (unsigned int i = 0; i < 3; i++)
+        lampOcclusion[i] = occlusionCuller.add(glm::min(lamp.boundsMin, nightlamp.boundsMin),
+                                               glm::max(lamp.boundsMax, nightlamp.boundsMax));
+    glm::vec3 lampPositions[] = {
+            glm::vec3(1.4f, 4.6f, -8.0f),
+            glm::vec3(-1.4f, 4.6f, -8.0f),
+            glm::vec3(-35.2f, 22.65f, -106.0f)
+    };
+    float lampScales[] = {0.01f, 0.01f, 0.017f};
+
 
     // lights
     DirLight dirLightDay;
@@ -273,6 +587,56 @@ int main() {
     pointLight6.linear = 0.09f;
     pointLight6.quadratic = 0.01f;
 
+    // the lights never change, so both light sets are uploaded once and the day/night
+    // switch only rebinds which of them the Lights block points at
+    LightUniforms nightLights;
+    nightLights.dirLight = dirLightNight;
+    nightLights.pointLights[0] = pointLight1;
+    nightLights.pointLights[1] = pointLight2;
+    nightLights.pointLights[2] = pointLight3;
+    nightLights.pointLights[3] = pointLight4;
+    nightLights.pointLights[4] = pointLight5;
+    nightLights.pointLights[5] = pointLight6;
+
+    // the oil lamps and the house light are off during the day
+    LightUniforms dayLights = nightLights;
+    dayLights.dirLight = dirLightDay;
+    for (unsigned int i : {0, 1, 4}) {
+        dayLights.pointLights[i].ambient = glm::vec3(0.0f);
+        dayLights.pointLights[i].diffuse = glm::vec3(0.0f);
+        dayLights.pointLights[i].specular = glm::vec3(0.0f);
+    }
+
+    GLintptr nightLightsOffset = UniformBuffer::alignedSize(sizeof(LightUniforms));
+    UniformBuffer lightUniforms(nightLightsOffset + sizeof(LightUniforms), nullptr, GL_STATIC_DRAW);
+    lightUniforms.update(0, sizeof(LightUniforms), &dayLights);
+    lightUniforms.update(nightLightsOffset, sizeof(LightUniforms), &nightLights);
+    lightUniforms.bindRange(LIGHT_UNIFORMS_BINDING, 0, sizeof(LightUniforms));
+    bool lightsAreDay = true;
+
+    // the deferred renderer and the clustered lights aren't limited to the six lights of the Lights
+    // block; at night they also light a ring of torches around the island
+    std::vector<PointLight> dayPointLights(dayLights.pointLights, dayLights.pointLights + NUM_POINT_LIGHTS);
+    std::vector<PointLight> nightPointLights(nightLights.pointLights, nightLights.pointLights + NUM_POINT_LIGHTS);
+    const unsigned int ISLAND_TORCHES = 200;
+    for (unsigned int i = 0; i < ISLAND_TORCHES; i++) {
+        float angle = 2.0f * glm::pi<float>() * i / ISLAND_TORCHES;
+        PointLight torch = pointLight6;
+        torch.position = glm::vec3(-28.0f, 18.0f, -111.0f) + 35.0f * glm::vec3(glm::cos(angle), 0.0f, glm::sin(angle));
+        torch.quadratic = 0.5f;
+        nightPointLights.push_back(torch);
+    }
+    DeferredRenderer deferredRenderer(deferredDirectionalShader, deferredPointShader);
+    deferredRenderer.setPointLights(dayPointLights);
+    // everything rewritten every frame (Frame and Clusters blocks, cluster light lists) goes through
+    // one ring buffer; 4 MB per frame fits the cluster lists of the night scene many times over
+    StreamBuffer streamBuffer(4 * 1024 * 1024);
+    // the shader warm-up draws before the first frame wrote the blocks, any range will do for it
+    streamBuffer.bindUniformRange(FRAME_UNIFORMS_BINDING, streamBuffer.allocate(sizeof(FrameUniforms)));
+    streamBuffer.bindUniformRange(CLUSTER_UNIFORMS_BINDING, streamBuffer.allocate(sizeof(ClusterUniforms)));
+    ClusteredLights clusteredLights(threadPool, streamBuffer);
+    clusteredLights.setPointLights(dayPointLights);
+
     // vertices
     float skullFlag[] = {
                     // positions            //normals             // texture Coords
@@ -402,7 +766,7 @@ int main() {
     unsigned int planeVAO, planeVBO;
     glGenVertexArrays(1, &planeVAO);
     glGenBuffers(1, &planeVBO);
-    glBindVertexArray(planeVAO);
+    glState().bindVertexArray(planeVAO);
     glBindBuffer(GL_ARRAY_BUFFER, planeVBO);
 
     glBufferData(GL_ARRAY_BUFFER, sizeof(skullFlag), &skullFlag, GL_STATIC_DRAW);
@@ -425,7 +789,7 @@ int main() {
     unsigned int grassVAO, grassVBO;
     glGenVertexArrays(1, &grassVAO);
     glGenBuffers(1, &grassVBO);
-    glBindVertexArray(grassVAO);
+    glState().bindVertexArray(grassVAO);
     glBindBuffer(GL_ARRAY_BUFFER, grassVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(grass), &grass, GL_STATIC_DRAW);
     glEnableVertexAttribArray(0);
@@ -437,7 +801,7 @@ int main() {
     unsigned int cubeVAO, cubeVBO;
     glGenVertexArrays(1, &cubeVAO);
     glGenBuffers(1, &cubeVBO);
-    glBindVertexArray(cubeVAO);
+    glState().bindVertexArray(cubeVAO);
     glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(cube), &cube, GL_STATIC_DRAW);
     glEnableVertexAttribArray(0);
@@ -447,7 +811,7 @@ int main() {
     unsigned int skyboxVAO, skyboxVBO;
     glGenVertexArrays(1, &skyboxVAO);
     glGenBuffers(1, &skyboxVBO);
-    glBindVertexArray(skyboxVAO);
+    glState().bindVertexArray(skyboxVAO);
     glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
     glEnableVertexAttribArray(0);
@@ -496,320 +860,461 @@ int main() {
     };
 
     // shader configuration
+    bindSceneUniformBlocks(skyboxShader);
+    bindSceneUniformBlocks(blendingShader);
+    bindSceneUniformBlocks(lightCubeShader);
+    bindSceneUniformBlocks(depthShader);
+    ClusteredLights::setupShader(blendingShader);
+
     skyboxShader.use();
     skyboxShader.setInt("skybox", 0);
 
-    lightingShader.use();
-    lightingShader.setInt("material.texture_diffuse1", 0);
-    lightingShader.setInt("material.texture_specular1", 1);
+    if (depthMultiDrawShader)
+        bindSceneUniformBlocks(*depthMultiDrawShader);
+    if (gBufferMultiDrawShader) {
+        bindSceneUniformBlocks(*gBufferMultiDrawShader);
+        gBufferMultiDrawShader->use();
+        gBufferMultiDrawShader->setInt("material.texture_diffuse1", Material::DIFFUSE);
+        gBufferMultiDrawShader->setInt("material.texture_specular1", Material::SPECULAR);
+    }
+    if (lightingMultiDrawShader) {
+        bindSceneUniformBlocks(*lightingMultiDrawShader);
+        lightingMultiDrawShader->use();
+        lightingMultiDrawShader->setFloat("material.shininess", 32.0f);
+        ClusteredLights::setupShader(*lightingMultiDrawShader);
+    }
 
 
     blendingShader.use();
     blendingShader.setInt("texture1", 0);
 
-    normalMappingShader.use();
-    normalMappingShader.setInt("diffuseMap", 0);
-    normalMappingShader.setInt("normalMap", 1);
+    shaderManager.warmUp();
+    programBinaryCache().printStats();
+
+    if (hasArgument(argc, argv, "--benchmark-uniforms")) {
+        UniformBenchmark benchmark(lightingVariants.get(ShaderVariants::HAS_SPECULAR_MAP), {&pirateShip, &pirate, &pirate2, &cannon, &island, &treasure,
+                                                    &lamp, &table, &zajecarac, &chair, &campfire});
+        benchmark.run(1000);
+        return 0;
+    }
+
+    // the view the first frame is compared against, taken while the camera is still ours to read
+    SimulationSnapshot lastView = captureSimulation();
+    // from here until it stops the simulation thread owns the camera and the height scale
+    Simulation<SimulationSnapshot> simulation(SIMULATION_TICK_RATE, simulate, captureSimulation);
+    simulation.start();
+
+    // headless and benchmark runs draw a fixed number of frames, the window decides otherwise
+    const bool limitFrames = headless || benchmarkPath;
+    unsigned int frameLimit = headlessFrames;
+    if (benchmarkPath)
+        frameLimit = WARM_UP_FRAMES + (unsigned int) ((flythrough.endTime() - flythrough.startTime()) / BENCHMARK_STEP + 0.5f)
+                     + 1;
+    // timed frames are always drawn at the full size, the governor would change it with the load
+    FrameTimes cpuFrameTimes, gpuFrameTimes;
+    unsigned int drawnFrames = 0;
+    if (limitFrames)
+        dynamicResolution = false;
 
     // render loop
     // -----------
-    while (!glfwWindowShouldClose(window)) {
+    while (!(window && glfwWindowShouldClose(window)) && !(limitFrames && drawnFrames >= frameLimit)) {
+        cpuProfiler().frameBoundary();
+        PROFILE_SCOPE("frame");
+
         // per-frame time logic
         // --------------------
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+        float alpha;
+        const Simulation<SimulationSnapshot>::Frame &simulated = simulation.latest(alpha);
+        SimulationSnapshot view = SimulationSnapshot::interpolate(simulated.previous, simulated.current, alpha);
+        if (benchmarkPath) {
+            // the path waits at its start while warming up
+            float pathTime = flythrough.startTime()
+                             + (drawnFrames > WARM_UP_FRAMES ? drawnFrames - WARM_UP_FRAMES : 0) * BENCHMARK_STEP;
+            flythrough.pose(pathTime, view.cameraPosition, view.cameraFront, view.cameraUp);
+            dayNnite = flythrough.dayAt(pathTime, true);
+        }
+        if (addPathKey) {
+            if (recordedPath.keyCount() == 0) {
+                pathRecordStart = glfwGetTime();
+                recordedPath.addLightChange(0.0f, dayNnite);
+            }
+            float time = glfwGetTime() - pathRecordStart;
+            recordedPath.addKey(time, view.cameraPosition, view.cameraFront);
+            std::cout << "record path: key " << recordedPath.keyCount() << " at " << time << " s" << std::endl;
+            addPathKey = false;
+        }
+        if (!(view == lastView))
+            framePacer.markDirty();
+        lastView = view;
 
         // input
         // -----
-        processInput(window);
+        if (window)
+            processInput(window);
+
+        // swap in edited shaders, models and textures before anything is drawn with them
+        if (hotReload.update())
+            framePacer.markDirty();
+
+        // nothing changed since the last frame drawn, wait for input or the next tick instead
+        if (!framePacer.shouldRender()) {
+            framePacer.idle(simulation.stepSeconds());
+            continue;
+        }
+        glState().beginFrame();
+        renderStats().beginFrame();
 
         // render
         // ------
+        int framebufferWidth = headlessContext.framebufferWidth(), framebufferHeight = headlessContext.framebufferHeight();
+        if (window)
+            glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        // with dynamic resolution the scene goes into the offscreen target at the governor's scale
+        // and is stretched over the window once it is done
+        glm::ivec2 renderSize(framebufferWidth, framebufferHeight);
+        if (dynamicResolution) {
+            governor.update(sceneTimer);
+            renderSize = sceneTarget.begin(framebufferWidth, framebufferHeight, governor.scale());
+        } else {
+            // full quality while it is off, and a fresh start when it comes back
+            governor.reset();
+            glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+            glState().viewport(0, 0, framebufferWidth, framebufferHeight);
+        }
+        unsigned int sceneFramebuffer = dynamicResolution ? sceneTarget.ID() : outputFramebuffer;
+        sceneTimer.begin();
+        profiler.beginFrame();
+
         glClearColor(programState->clearColor.r, programState->clearColor.g, programState->clearColor.b, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        // view/projection transformations, shared by every shader through the Frame block
+        const float nearPlane = 0.1f, farPlane = 3000.0f;
+        FrameUniforms frame;
+        frame.projection = glm::perspective(glm::radians(view.zoom),
+                                            (float) renderSize.x / (float) renderSize.y, nearPlane, farPlane);
+        frame.view = glm::lookAt(view.cameraPosition, view.cameraPosition + view.cameraFront, view.cameraUp);
+        frame.viewPosition = view.cameraPosition;
+        streamBuffer.beginFrame();
+        streamBuffer.bindUniformRange(FRAME_UNIFORMS_BINDING, streamBuffer.writeUniforms(frame));
 
         // lighting
-        lightingShader.use();
-        // view/projection transformations
-        glm::mat4 projection = glm::perspective(glm::radians(programState->camera.Zoom),
-                                                (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 3000.0f);
-        glm::mat4 view = programState->camera.GetViewMatrix();
-        lightingShader.setMat4("projection", projection);
-        lightingShader.setMat4("view", view);
-
-        lightIt(lightingShader, pointLight1, pointLight2, pointLight3, pointLight4, pointLight5, pointLight6);
-        lightIt(blendingShader, pointLight1, pointLight2, pointLight3, pointLight4, pointLight5, pointLight6);
-        lightDirLight(lightingShader, dirLightDay, dirLightNight);
-        lightDirLight(blendingShader, dirLightDay, dirLightNight);
-
-
-        // normal mapping
-        normalMappingShader.use();
-        // view/projection transformations
-        projection = glm::perspective(glm::radians(programState->camera.Zoom),
-                                                (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 3000.0f);
-        view = programState->camera.GetViewMatrix();
-        normalMappingShader.setMat4("projection", projection);
-        normalMappingShader.setMat4("view", view);
-        // render normal-mapped quad
-        glm::mat4 model = glm::mat4(1.0f);
-        //model = glm::rotate(model, glm::radians((float)glfwGetTime() * -10.0f), glm::normalize(glm::vec3(1.0, 0.0, 1.0))); // rotate the quad to show normal mapping from multiple directions
-        model = glm::translate(model, glm::vec3(0.0f, 5.0f, -8.3f));
-        model = glm::translate(model, programState->shipPosition);
-        model = glm::scale(model, glm::vec3(0.8f, 1.2f, 1.2f));
-        normalMappingShader.setMat4("model", model);
-        normalMappingShader.setVec3("viewPos", programState->camera.Position);
-        normalMappingShader.setVec3("lightPos1", pointLight1.position);
-        normalMappingShader.setVec3("lightPos2", pointLight2.position);
-        normalMappingShader.setFloat("heightScale", heightScale);
-
-        lightPointNormal(normalMappingShader, pointLight1, pointLight2);
-        lightDirLight(normalMappingShader, dirLightDay, dirLightNight);
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, woodDiffTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, woodNormTexture);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, woodDispTexture);
-        renderQuad();
+        if (dayNnite != lightsAreDay) {
+            lightUniforms.bindRange(LIGHT_UNIFORMS_BINDING, dayNnite ? 0 : nightLightsOffset, sizeof(LightUniforms));
+            deferredRenderer.setPointLights(dayNnite ? dayPointLights : nightPointLights);
+            clusteredLights.setPointLights(dayNnite ? dayPointLights : nightPointLights);
+            lightsAreDay = dayNnite;
+        }
+        // the forward shaders only loop over the point lights of their cluster
+        clusteredLights.update(frame.view, frame.projection, nearPlane, farPlane, renderSize.x, renderSize.y);
+        clusteredLights.bind();
+        // all per-frame data is written, without persistent mapping this uploads it
+        streamBuffer.flush();
+
+        occlusionCuller.enabled = occlusionCulling;
+        occlusionCuller.beginFrame(view.cameraPosition);
+        if (staticBatching)
+            staticBatches.cull(frame.projection * frame.view);
+        else
+            staticDrawList.cull(frame.projection * frame.view, view.cameraPosition);
 
 
         // render objects
-        lightingShader.use();
-        // pirateship
-        model = glm::mat4(1.0f); // initialization
-        model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(1.2f, 1.2f, 1.2f));
-        lightingShader.setMat4("model", model);
-        pirateShip.Draw(lightingShader);
-
-        // pirate
-        model = glm::mat4(1.0f); // initialization
-        model = glm:: translate(model, glm::vec3(0.5f, 6.72f, -10.6f));
-        model = glm::rotate(model, glm::radians(270.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(0.017f, 0.017f, 0.017f));
-        lightingShader.setMat4("model", model);
-        pirate.Draw(lightingShader);
-
-        // pirate2
-        model = glm::mat4(1.0f); // initialization
-        model = glm:: translate(model, glm::vec3(3.2f, 3.81f, -3.6f));
-        model = glm::rotate(model, glm::radians(270.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        model = glm::scale(model, glm::vec3(0.04f, 0.04f, 0.04f));
-        lightingShader.setMat4("model", model);
-        pirate2.Draw(lightingShader);
-
-        // cannon
-        model = glm::mat4(1.0f); // initialization
-        model = glm:: translate(model, glm::vec3(1.9f, 3.81f, 2.7f));
-        model = glm::rotate(model, glm::radians(270.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(-28.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        model = glm::scale(model, glm::vec3(0.022f, 0.022f, 0.022f));
-        lightingShader.setMat4("model", model);
-        cannon.Draw(lightingShader);
-        model = glm::mat4(1.0f); // initialization
-        model = glm:: translate(model, glm::vec3(-1.9f, 3.81f, 2.7f));
-        model = glm::rotate(model, glm::radians(270.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(-150.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        model = glm::scale(model, glm::vec3(0.022f, 0.022f, 0.022f));
-        lightingShader.setMat4("model", model);
-        cannon.Draw(lightingShader);
+        // the lighting.fs models are either lit right away or written into the G-buffer
+        ShaderVariants &opaqueVariants = deferredShading ? gBufferVariants : lightingVariants;
+        Shader *opaqueMultiDrawShader = deferredShading ? gBufferMultiDrawShader.get() : lightingMultiDrawShader.get();
+        if (deferredShading) {
+            deferredRenderer.resize(framebufferWidth, framebufferHeight);
+            deferredRenderer.beginGeometryPass();
+        }
 
         // island
-        model = glm::mat4(1.0f); // initialization
-        model = glm:: translate(model, glm::vec3(-28.0f, 0.0f, -111.0f));
-        model = glm::scale(model, glm::vec3(0.6f, 0.6f, 0.6f));
-        lightingShader.setMat4("model", model);
-        island.Draw(lightingShader);
-
-        // treasure
-        model = glm::mat4(1.0f); // initialization
-        model = glm:: translate(model, glm::vec3(-3.22f, 6.6f, -12.9f));
-        model = glm::rotate(model, glm::radians(270.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        model = glm::scale(model, glm::vec3(0.017f, 0.017f, 0.017f));
-        lightingShader.setMat4("model", model);
-        treasure.Draw(lightingShader);
-        model = glm::mat4(1.0f); // initialization
-        model = glm:: translate(model, glm::vec3(3.22f, 6.6f, -12.9f));
-        model = glm::rotate(model, glm::radians(270.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        model = glm::scale(model, glm::vec3(0.017f, 0.017f, 0.017f));
-        lightingShader.setMat4("model", model);
-        treasure.Draw(lightingShader);
+        glm::mat4 islandModel = glm::mat4(1.0f); // initialization
+        islandModel = glm:: translate(islandModel, glm::vec3(-28.0f, 0.0f, -111.0f));
+        islandModel = glm::scale(islandModel, glm::vec3(0.6f, 0.6f, 0.6f));
 
         // lamp
-        if(dayNnite) {
-            model = glm::mat4(1.0f); // initialization
-            model = glm::translate(model, glm::vec3(1.4f, 4.6f, -8.0f));
-            model = glm::scale(model, glm::vec3(0.01f, 0.01f, 0.01f));
-            lightingShader.setMat4("model", model);
-            lamp.Draw(lightingShader);
-            model = glm::mat4(1.0f); // initialization
-            model = glm::translate(model, glm::vec3(-1.4f, 4.6f, -8.0f));
-            model = glm::scale(model, glm::vec3(0.01f, 0.01f, 0.01f));
-            lightingShader.setMat4("model", model);
-            lamp.Draw(lightingShader);
-            model = glm::mat4(1.0f); // initialization
-            model = glm::translate(model, glm::vec3(-35.2f, 22.65f, -106.0f));
-            model = glm::scale(model, glm::vec3(0.017f, 0.017f, 0.017f));
-            lightingShader.setMat4("model", model);
-            lamp.Draw(lightingShader);
-        }
-        else {
-            model = glm::mat4(1.0f); // initialization
-            model = glm::translate(model, glm::vec3(1.4f, 4.6f, -8.0f));
-            model = glm::scale(model, glm::vec3(0.01f, 0.01f, 0.01f));
-            lightingShader.setMat4("model", model);
-            nightlamp.Draw(lightingShader);
-            model = glm::mat4(1.0f); // initialization
-            model = glm::translate(model, glm::vec3(-1.4f, 4.6f, -8.0f));
-            model = glm::scale(model, glm::vec3(0.01f, 0.01f, 0.01f));
-            lightingShader.setMat4("model", model);
-            nightlamp.Draw(lightingShader);
-            model = glm::mat4(1.0f); // initialization
-            model = glm::translate(model, glm::vec3(-35.2f, 22.65f, -106.0f));
-            model = glm::scale(model, glm::vec3(0.017f, 0.017f, 0.017f));
-            lightingShader.setMat4("model", model);
-            nightlamp.Draw(lightingShader);
+        Model &lantern = dayNnite ? lamp : nightlamp;
+        glm::mat4 lampModels[3];
+        for (unsigned int i = 0; i < 3; i++) {
+            lampModels[i] = glm::mat4(1.0f); // initialization
+            lampModels[i] = glm::translate(lampModels[i], lampPositions[i]);
+            lampModels[i] = glm::scale(lampModels[i], glm::vec3(lampScales[i]));
         }
-        // table
-        model = glm::mat4(1.0f); // initialization
-        model = glm:: translate(model, glm::vec3(-35.5f, 20.0f, -105.3f));
-        model = glm::rotate(model, glm::radians(-15.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(0.5f, 0.3f, 0.4f));
-        lightingShader.setMat4("model", model);
-        table.Draw(lightingShader);
-
-        // +1.5 0 -5.3
-        // zajecarac
-        model = glm::mat4(1.0f); // initialization
-        model = glm:: translate(model, glm::vec3(-33.5f, 22.6f, -104.7f));
-        //model = glm::rotate(model, glm::radians(120.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(0.2f, 0.2f, 0.2f));
-        lightingShader.setMat4("model", model);
-        zajecarac.Draw(lightingShader);
-        model = glm::mat4(1.0f); // initialization
-        model = glm:: translate(model, glm::vec3(-37.0f, 22.6f, -105.1f));
-        //model = glm::rotate(model, glm::radians(170.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(0.2f, 0.2f, 0.2f));
-        lightingShader.setMat4("model", model);
-        zajecarac.Draw(lightingShader);
-
-        // chair
-        model = glm::mat4(1.0f); // initialization
-        model = glm:: translate(model, glm::vec3(-38.3f, 20.0f, -103.0f));
-        model = glm::rotate(model, glm::radians(70.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(4.0f, 4.0f, 4.0f));
-        lightingShader.setMat4("model", model);
-        chair.Draw(lightingShader);
-        model = glm::mat4(1.0f); // initialization
-        model = glm:: translate(model, glm::vec3(-31.2f, 20.0f, -104.7f));
-        //model = glm::rotate(model, glm::radians(165.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(4.0f, 4.0f, 4.0f));
-        lightingShader.setMat4("model", model);
-        chair.Draw(lightingShader);
 
         // campfire
-        model = glm::mat4(1.0f); // initialization
-        model = glm:: translate(model, glm::vec3(-14.6f, 1.8f, -53.5f));
+        glm::mat4 campfireModel = glm::mat4(1.0f); // initialization
+        campfireModel = glm:: translate(campfireModel, glm::vec3(-14.6f, 1.8f, -53.5f));
         //model = glm::rotate(model, glm::radians(165.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(0.05f, 0.05f, 0.05f));
-        lightingShader.setMat4("model", model);
-        campfire.Draw(lightingShader);
+        campfireModel = glm::scale(campfireModel, glm::vec3(0.05f, 0.05f, 0.05f));
+
+        // island, lamps and campfire go through the occlusion culler; the first pass of the frame
+        // issues the queries, a later pass draws under the same conditions
+        auto drawCulled = [&](bool firstPass, bool depthOnly) {
+            auto drawModel = [&](unsigned int handle, Model &object, const glm::mat4 &transform) {
+                auto drawFunction = [&]() {
+                    if (depthOnly) {
+                        depthShader.use();
+                        depthShader.setMat4("model"_uniform, transform);
+                        object.DrawGeometry();
+                    } else {
+                        object.Draw(opaqueVariants, 0, transform);
+                    }
+                };
+                if (firstPass)
+                    occlusionCuller.draw(handle, transform, drawFunction);
+                else
+                    occlusionCuller.repeat(handle, drawFunction);
+            };
+            drawModel(islandOcclusion, island, islandModel);
+            for (unsigned int i = 0; i < 3; i++)
+                drawModel(lampOcclusion[i], lantern, lampModels[i]);
+            drawModel(campfireOcclusion, campfire, campfireModel);
+        };
+
+        profiler.begin("opaque models");
+        // the G-buffer pass writes every pixel once anyway
+        bool prepass = (depthPrepass || governor.level() >= 1) && !deferredShading;
+        if (prepass) {
+            // lay down the depth of everything opaque first, so the colour pass shades each pixel once
+            profiler.begin("depth pre-pass");
+            glState().colorMask(false);
+            if (staticBatching) {
+                staticBatches.drawDepth(depthShader);
+            } else {
+                depthShader.use();
+                staticDrawList.drawDepth(depthShader, depthMultiDrawShader.get());
+            }
+            drawCulled(true, true);
+            glState().colorMask(true);
+            glState().depthMask(false);
+            glState().depthFunc(GL_EQUAL);
+            profiler.end();
+        }
+
+        // the static props go out in as few draws as the driver allows, or as their visible batches
+        profiler.begin("ship props");
+        if (staticBatching)
+            staticBatches.draw(opaqueVariants, 0);
+        else
+            staticDrawList.draw(opaqueVariants, 0, opaqueMultiDrawShader);
+        profiler.end();
+        profiler.begin("island, lamps, campfire");
+        drawCulled(!prepass, false);
+        profiler.end();
+
+        if (prepass) {
+            glState().depthMask(true);
+            glState().depthFunc(GL_LESS);
+        }
 
         // flag
+        profiler.begin("flag");
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(0.0f, 4.2f, -15.2f));
         model = glm::rotate(model, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
         model = glm::scale(model, glm::vec3(2.0f, 2.0f, 2.0f));
-        glBindVertexArray(planeVAO);
-        glBindTexture(GL_TEXTURE_2D, flagTexture);
-        lightingShader.setMat4("model", model);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        Shader &flagShader = opaqueVariants.get(0);
+        flagShader.use();
+        glState().bindVertexArray(planeVAO);
+        glState().bindTexture(0, GL_TEXTURE_2D, flagTexture);
+        flagShader.setMat4("model"_uniform, model);
+        renderStats().drawArrays(GL_TRIANGLES, 0, 6);
+        profiler.end();
+
+        profiler.begin("water");
+        Shader &waterShader = opaqueVariants.get(ShaderVariants::HAS_SPECULAR_MAP);
+        waterShader.use();
+        // enable face culling
+        glState().setEnabled(GL_CULL_FACE, true);
+        // water
+        model = glm::mat4(1.0f);
+        model = glm::scale(model, glm::vec3(20000.0f, 0.0f, 20000.0f));
+        glState().bindVertexArray(planeVAO);
+        glState().bindTexture(0, GL_TEXTURE_2D, waterTexDiff);
+        glState().bindTexture(1, GL_TEXTURE_2D, waterTexSpec);
+        waterShader.setMat4("model"_uniform, model);
+        renderStats().drawArrays(GL_TRIANGLES, 0, 6);
+        // disable face culling
+        glState().setEnabled(GL_CULL_FACE, false);
+        profiler.end();
+
+        if (deferredShading) {
+            profiler.begin("deferred lighting");
+            deferredRenderer.endGeometryPass(glm::inverse(frame.projection * frame.view), 32.0f, renderSize,
+                                             sceneFramebuffer);
+            profiler.end();
+        }
+        profiler.end();
+
+
+        // normal mapping, parallax only costs something once the height scale is raised
+        profiler.begin("normal-mapped door");
+        bool parallax = view.heightScale > 0.0f && governor.level() < 2;
+        Shader &normalMappingShader = normalMappingVariants.get(parallax ? ShaderVariants::PARALLAX : 0);
+        normalMappingShader.use();
+        // render normal-mapped quad
+        model = glm::mat4(1.0f);
+        //model = glm::rotate(model, glm::radians((float)glfwGetTime() * -10.0f), glm::normalize(glm::vec3(1.0, 0.0, 1.0))); // rotate the quad to show normal mapping from multiple directions
+        model = glm::translate(model, glm::vec3(0.0f, 5.0f, -8.3f));
+        model = glm::translate(model, programState->shipPosition);
+        model = glm::scale(model, glm::vec3(0.8f, 1.2f, 1.2f));
+        normalMappingShader.setMat4("model"_uniform, model);
+        normalMappingShader.setFloat("heightScale"_uniform, view.heightScale);
+
+        glState().bindTexture(0, GL_TEXTURE_2D, woodDiffTexture);
+        glState().bindTexture(1, GL_TEXTURE_2D, woodNormTexture);
+        glState().bindTexture(2, GL_TEXTURE_2D, woodDispTexture);
+        renderQuad();
+        profiler.end();
 
         // Blending: grass
+        profiler.begin("grass");
         blendingShader.use();
-        blendingShader.setMat4("view", view);
-        blendingShader.setMat4("projection", projection);
         for(int i = 0; i < vegetation.size(); i++){
-            glBindVertexArray(grassVAO);
-            glBindTexture(GL_TEXTURE_2D, grassTexture);
+            glState().bindVertexArray(grassVAO);
+            glState().bindTexture(0, GL_TEXTURE_2D, grassTexture);
             model = glm::mat4(1.0f);
             model = glm::translate(model, vegetation[i]);
             model = glm::scale(model, glm::vec3(3.0f, 3.0f, 3.0f));
-            blendingShader.setMat4("model", model);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
+            blendingShader.setMat4("model"_uniform, model);
+            renderStats().drawArrays(GL_TRIANGLES, 0, 6);
         }
+        profiler.end();
 
 
 
-        lightingShader.use();
-        // enable face culling
-        glEnable(GL_CULL_FACE);
-        // water
-        model = glm::mat4(1.0f);
-        model = glm::scale(model, glm::vec3(20000.0f, 0.0f, 20000.0f));
-        glBindVertexArray(planeVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, waterTexDiff);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, waterTexSpec);
-        lightingShader.setMat4("model", model);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        // disable face culling
-        glDisable(GL_CULL_FACE);
-
-
         // firecube
+        profiler.begin("fire cube");
         lightCubeShader.use();
-        lightCubeShader.setMat4("projection", projection);
-        lightCubeShader.setMat4("view", view);
-        glBindVertexArray(cubeVAO);
+        glState().bindVertexArray(cubeVAO);
         model = glm::mat4(1.0);
         model = glm::translate(model, programState->shipPosition);
         model = glm::translate(model, glm::vec3(-14.6f, 2.5f, -53.5f));
         model = glm::scale(model,glm::vec3(programState->shipScale));
-        lightCubeShader.setMat4("model", model);
-        lightCubeShader.setVec3("lightColor", glm::vec3(0.99f, 0.31f, 0.0f)); //254,80,0
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        lightCubeShader.setMat4("model"_uniform, model);
+        lightCubeShader.setVec3("lightColor"_uniform, glm::vec3(0.99f, 0.31f, 0.0f)); //254,80,0
+        renderStats().drawArrays(GL_TRIANGLES, 0, 36);
+        profiler.end();
 
 
         // draw skybox as last
-        glDepthMask(GL_FALSE);
-        glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
+        profiler.begin("skybox");
+        glState().depthMask(false);
+        glState().depthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
         skyboxShader.use();
-        view = glm::mat4(glm::mat3(programState->camera.GetViewMatrix())); // remove translation from the view matrix
-        skyboxShader.setMat4("view", view);
-        skyboxShader.setMat4("projection", projection);
         // skybox cube
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
+        glState().bindVertexArray(skyboxVAO);
         if(dayNnite)
-            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTextureDay);
+            glState().bindTexture(0, GL_TEXTURE_CUBE_MAP, cubemapTextureDay);
         else
-            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTextureNight);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS); // set depth function back to default
-        glDepthMask(GL_TRUE);
-
-
-        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-        // -------------------------------------------------------------------------------
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+            glState().bindTexture(0, GL_TEXTURE_CUBE_MAP, cubemapTextureNight);
+        renderStats().drawArrays(GL_TRIANGLES, 0, 36);
+        glState().depthFunc(GL_LESS); // set depth function back to default
+        glState().depthMask(true);
+        profiler.end();
+        sceneTimer.end();
+
+        profiler.begin("post");
+        if (dynamicResolution)
+            sceneTarget.upscale(outputFramebuffer);
+        if (performanceOverlay) {
+            performanceOverlay->visible = showPerformanceOverlay;
+            performanceOverlay->draw(profiler, renderStats(), framePacer, dynamicResolution ? governor.scale() : 1.0f);
+        }
+        profiler.end();
+        profiler.endFrame();
+
+        if (printFrameStats) {
+            glState().printLastFrame();
+            renderStats().printLastFrame();
+            std::cout << "opaque models: " << profiler.average("opaque models") << " ms GPU, "
+                      << (deferredShading ? "deferred, " : "forward, ") << "depth pre-pass "
+                      << (prepass ? "on" : "off") << std::endl;
+            if (staticBatching)
+                std::cout << "static batches: " << staticBatches.visibleCount() << " of " << staticBatches.batchCount()
+                          << " drawn" << std::endl;
+            else if (staticDrawList.multiDraw())
+                std::cout << "static batches: off, multi draw indirect, " << staticDrawList.recordedCount()
+                          << " meshes drawn" << std::endl;
+            else
+                std::cout << "static batches: off, " << staticDrawList.recordedCount() << " meshes recorded over "
+                          << threadPool.size() << " threads" << std::endl;
+            std::cout << "clustered lights: " << clusteredLights.lightCount() << " point lights, "
+                      << clusteredLights.assignedCount() << " cluster entries over " << threadPool.size()
+                      << " threads" << std::endl;
+            std::cout << "simulation: tick " << simulated.tick << " at " << SIMULATION_TICK_RATE << " Hz, "
+                      << simulation.droppedTicks() << " ticks dropped" << std::endl;
+            std::cout << "stream buffer: " << streamBuffer.lastFrameUsage() << " of " << streamBuffer.frameCapacity()
+                      << " bytes, " << (streamBuffer.persistent() ? "persistently mapped, " : "orphaned, ")
+                      << streamBuffer.stallCount() << " stalls" << std::endl;
+            framePacer.printStats();
+            if (dynamicResolution)
+                governor.printStats();
+            else
+                std::cout << "frame time governor: off, scene " << sceneTimer.milliseconds() << " ms GPU" << std::endl;
+            printFrameStats = false;
+        }
+        // the fence of this frame's region goes in after its last draw
+        streamBuffer.endFrame();
+
+        if (headless) {
+            // nothing presents, waiting for the GPU makes the time between frames the time to draw one
+            PROFILE_SCOPE("glFinish");
+            glFinish();
+        } else {
+            // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+            // -------------------------------------------------------------------------------
+            framePacer.waitForPresent();
+            PROFILE_SCOPE("glfwSwapBuffers");
+            glfwSwapBuffers(window);
+        }
+        framePacer.presented();
+        if (++drawnFrames == WARM_UP_FRAMES && limitFrames) {
+            framePacer.recordIntervals(&cpuFrameTimes);
+            profiler.recordFrameTimes(&gpuFrameTimes);
+        }
+        if (window)
+            glfwPollEvents();
     }
 
+    simulation.stop();
+    int result = 0;
+    if (limitFrames) {
+        int width = headlessContext.framebufferWidth(), height = headlessContext.framebufferHeight();
+        if (window)
+            glfwGetFramebufferSize(window, &width, &height);
+        std::cout << (benchmarkPath ? "benchmark: " : "headless: ") << drawnFrames << " frames at " << width << 'x'
+                  << height << ", the first " << WARM_UP_FRAMES << " not timed" << std::endl;
+        cpuFrameTimes.print("CPU frame");
+        gpuFrameTimes.print("GPU frame");
+        if (benchmarkPath) {
+            BenchmarkReport report(benchmarkPath, width, height, cpuFrameTimes, gpuFrameTimes);
+            if (const char *path = argumentValue(argc, argv, "--benchmark-output"))
+                report.write(path);
+            if (const char *path = argumentValue(argc, argv, "--benchmark-baseline"))
+                if (!report.compare(path))
+                    result = 1;
+        }
+    }
+    if (headless)
+        if (const char *path = argumentValue(argc, argv, "--write-frame"))
+            if (headlessContext.writePPM(path))
+                std::cout << "headless: last frame written to " << path << std::endl;
+    if (recordedPathFile) {
+        if (recordedPath.keyCount() < 2)
+            std::cout << "record path: " << recordedPath.keyCount() << " keys, a path needs two" << std::endl;
+        else if (recordedPath.save(recordedPathFile))
+            std::cout << "record path: " << recordedPath.keyCount() << " keys written to " << recordedPathFile
+                      << std::endl;
+    }
     programState->SaveToFile("resources/program_state.txt");
     delete programState;
 
-    // glfw: terminate, clearing all previously allocated GLFW resources.
-    // ------------------------------------------------------------------
+    // ImGui shuts its GLFW backend down before the window goes, the rest of the GL objects are
+    // destroyed on the way out, glfwTerminateOnExit last
+    performanceOverlay.reset();
     glDeleteVertexArrays(1, &planeVAO);
     glDeleteVertexArrays(1, &skyboxVAO);
     glDeleteVertexArrays(1, &grassVAO);
@@ -818,40 +1323,48 @@ int main() {
     glDeleteBuffers(1, &skyboxVBO);
     glDeleteBuffers(1, &grassVBO);
     glDeleteBuffers(1, &cubeVBO);
-    glfwTerminate();
-    return 0;
+    return result;
 }
 
-// process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
+// process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly;
+// the keys that drive the simulation are handed to it by key_callback
 // ---------------------------------------------------------------------------------------------------------
 void processInput(GLFWwindow *window) {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
+}
 
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(FORWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(BACKWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(LEFT, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(RIGHT, deltaTime);
-
-    if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
-    {
-        if (heightScale > 0.0f)
-            heightScale -= 0.005f;
-        else
-            heightScale = 0.0f;
-    }
-    else if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS)
-    {
-        if (heightScale < 1.0f)
-            heightScale += 0.005f;
-        else
-            heightScale = 1.0f;
-    }
+// advances the camera and the height scale by one tick of the simulation thread
+// -----------------------------------------------------------------------------
+void simulate(float step) {
+    unsigned int held = simulationInput.heldActions();
+    Camera &camera = programState->camera;
+    if (held & MOVE_FORWARD)
+        camera.ProcessKeyboard(FORWARD, step);
+    if (held & MOVE_BACKWARD)
+        camera.ProcessKeyboard(BACKWARD, step);
+    if (held & MOVE_LEFT)
+        camera.ProcessKeyboard(LEFT, step);
+    if (held & MOVE_RIGHT)
+        camera.ProcessKeyboard(RIGHT, step);
+
+    glm::vec2 mouse;
+    float scrolled;
+    simulationInput.takeMotion(mouse, scrolled);
+    if (mouse.x != 0.0f || mouse.y != 0.0f)
+        camera.ProcessMouseMovement(mouse.x, mouse.y);
+    if (scrolled != 0.0f)
+        camera.ProcessMouseScroll(scrolled);
+
+    if (held & LOWER_HEIGHT_SCALE)
+        heightScale = std::max(heightScale - HEIGHT_SCALE_SPEED * step, 0.0f);
+    else if (held & RAISE_HEIGHT_SCALE)
+        heightScale = std::min(heightScale + HEIGHT_SCALE_SPEED * step, 1.0f);
+}
 
+SimulationSnapshot captureSimulation() {
+    const Camera &camera = programState->camera;
+    return SimulationSnapshot{camera.Position, camera.Front, camera.Up, camera.Zoom, heightScale};
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -859,7 +1372,14 @@ void processInput(GLFWwindow *window) {
 void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
     // make sure the viewport matches the new window dimensions; note that width and
     // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
+    glState().viewport(0, 0, width, height);
+    framePacer.markDirty();
+}
+
+// glfw: whenever the window needs to be drawn again (uncovered, restored), this callback is called
+// -------------------------------------------------------------------------------------------------
+void window_refresh_callback(GLFWwindow *window) {
+    framePacer.markDirty();
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -878,18 +1398,63 @@ void mouse_callback(GLFWwindow *window, double xpos, double ypos) {
     lastY = ypos;
 
     if (programState->CameraMouseMovementUpdateEnabled)
-        programState->camera.ProcessMouseMovement(xoffset, yoffset);
+        simulationInput.moveMouse(xoffset, yoffset);
+    framePacer.markDirty();
 }
 
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
 // ----------------------------------------------------------------------
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset) {
-    programState->camera.ProcessMouseScroll(yoffset);
+    simulationInput.scroll(yoffset);
+    framePacer.markDirty();
 }
 
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
-    if (key == GLFW_KEY_L && action == GLFW_PRESS)
+    unsigned int simulated = 0;
+    switch (key) {
+        case GLFW_KEY_W: simulated = MOVE_FORWARD; break;
+        case GLFW_KEY_S: simulated = MOVE_BACKWARD; break;
+        case GLFW_KEY_A: simulated = MOVE_LEFT; break;
+        case GLFW_KEY_D: simulated = MOVE_RIGHT; break;
+        case GLFW_KEY_Q: simulated = LOWER_HEIGHT_SCALE; break;
+        case GLFW_KEY_E: simulated = RAISE_HEIGHT_SCALE; break;
+    }
+    if (action == GLFW_PRESS)
+        simulationInput.press(simulated);
+    else if (action == GLFW_RELEASE)
+        simulationInput.release(simulated);
+    framePacer.markDirty();
+
+    if (key == GLFW_KEY_L && action == GLFW_PRESS) {
         dayNnite = !dayNnite;
+        if (recordedPathFile && recordedPath.keyCount() > 0)
+            recordedPath.addLightChange(glfwGetTime() - pathRecordStart, dayNnite);
+    }
+    if (key == GLFW_KEY_K && action == GLFW_PRESS && recordedPathFile)
+        addPathKey = true;
+    if (key == GLFW_KEY_O && action == GLFW_PRESS)
+        occlusionCulling = !occlusionCulling;
+    if (key == GLFW_KEY_P && action == GLFW_PRESS)
+        depthPrepass = !depthPrepass;
+    if (key == GLFW_KEY_F && action == GLFW_PRESS)
+        deferredShading = !deferredShading;
+    if (key == GLFW_KEY_B && action == GLFW_PRESS)
+        staticBatching = !staticBatching;
+    if (key == GLFW_KEY_G && action == GLFW_PRESS)
+        printFrameStats = true;
+    if (key == GLFW_KEY_H && action == GLFW_PRESS)
+        showPerformanceOverlay = !showPerformanceOverlay;
+    if (key == GLFW_KEY_R && action == GLFW_PRESS)
+        dynamicResolution = !dynamicResolution;
+    if (key == GLFW_KEY_T && action == GLFW_PRESS && !cpuProfiler().capturing()) {
+        std::string path = "trace_" + std::to_string(++traceCount) + ".json";
+        std::cout << "cpu profiler: capturing " << TRACE_FRAMES << " frames into " << path << std::endl;
+        cpuProfiler().capture(TRACE_FRAMES, path);
+    }
+    if (key == GLFW_KEY_V && action == GLFW_PRESS) {
+        framePacer.setMode((FramePacer::Mode) ((framePacer.mode() + 1) % FramePacer::MODE_COUNT));
+        std::cout << "frame pacing: " << FramePacer::modeName(framePacer.mode()) << std::endl;
+    }
 }
 unsigned int loadTexture(char const * path)
 {
@@ -897,7 +1462,11 @@ unsigned int loadTexture(char const * path)
     glGenTextures(1, &textureID);
 
     int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
+    unsigned char *data;
+    {
+        PROFILE_SCOPE("texture decode");
+        data = stbi_load(path, &width, &height, &nrComponents, 0);
+    }
     if (data)
     {
         GLenum format;
@@ -908,8 +1477,9 @@ unsigned int loadTexture(char const * path)
         else if (nrComponents == 4)
             format = GL_RGBA;
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
+        glState().bindTexture(0, GL_TEXTURE_2D, textureID);
         glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        renderStats().bufferUpload((unsigned long long) width * height * nrComponents);
         glGenerateMipmap(GL_TEXTURE_2D);
 
 //        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT); // for this tutorial: use GL_CLAMP_TO_EDGE to prevent semi-transparent borders. Due to interpolation it takes texels from next repeat
@@ -934,15 +1504,20 @@ unsigned int loadCubemap(vector<std::string> faces)
 {
     unsigned int textureID;
     glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+    glState().bindTexture(0, GL_TEXTURE_CUBE_MAP, textureID);
 
     int width, height, nrChannels;
     for (unsigned int i = 0; i < faces.size(); i++)
     {
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
+        unsigned char *data;
+        {
+            PROFILE_SCOPE("texture decode");
+            data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
+        }
         if (data)
         {
             glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+            renderStats().bufferUpload((unsigned long long) width * height * 3);
             stbi_image_free(data);
         }
         else
@@ -960,188 +1535,6 @@ unsigned int loadCubemap(vector<std::string> faces)
     return textureID;
 }
 
-// directional lighting
-void lightDirLight(Shader shader, DirLight dirLightDay, DirLight dirLightNight){
-    shader.use();
-    if(dayNnite){
-
-        // Dir Light
-        shader.setVec3("dirLight.direction", dirLightDay.direction);
-        shader.setVec3("dirLight.ambient", dirLightDay.ambient);
-        shader.setVec3("dirLight.diffuse", dirLightDay.diffuse);
-        shader.setVec3("dirLight.specular", dirLightDay.specular);
-    }
-    else{
-        // Dir Light
-        shader.setVec3("dirLight.direction", dirLightNight.direction);
-        shader.setVec3("dirLight.ambient", dirLightNight.ambient);
-        shader.setVec3("dirLight.diffuse", dirLightNight.diffuse);
-        shader.setVec3("dirLight.specular", dirLightNight.specular);
-    }
-}
-
-// point lighting for normal mapping (only 2 lamps are next to wooden door with normal and parallax mapping included)
-void lightPointNormal(Shader shader, PointLight pointLight1, PointLight pointLight2){
-    shader.use();
-
-    if(dayNnite){
-        shader.setVec3("pointLight1.position", pointLight1.position);
-        shader.setVec3("pointLight1.ambient", glm::vec3(0.0f, 0.0f, 0.0f));
-        shader.setVec3("pointLight1.diffuse", glm::vec3(0.0f, 0.0f, 0.0f));
-        shader.setVec3("pointLight1.specular", glm::vec3(0.0f, 0.0f, 0.0f));
-        shader.setFloat("pointLight1.constant", pointLight1.constant);
-        shader.setFloat("pointLight1.linear", pointLight1.linear);
-        shader.setFloat("pointLight1.quadratic", pointLight1.quadratic);
-        shader.setVec3("viewPosition", programState->camera.Position);
-        shader.setFloat("material.shininess", 32.0f);
-
-        shader.setVec3("pointLight2.position", pointLight2.position);
-        shader.setVec3("pointLight2.ambient", glm::vec3(0.0f, 0.0f, 0.0f));
-        shader.setVec3("pointLight2.diffuse", glm::vec3(0.0f, 0.0f, 0.0f));
-        shader.setVec3("pointLight2.specular", glm::vec3(0.0f, 0.0f, 0.0f));
-        shader.setFloat("pointLight2.constant", pointLight2.constant);
-        shader.setFloat("pointLight2.linear", pointLight2.linear);
-        shader.setFloat("pointLight2.quadratic", pointLight2.quadratic);
-        shader.setVec3("viewPosition", programState->camera.Position);
-        shader.setFloat("material.shininess", 32.0f);
-    }
-    else{
-        shader.setVec3("pointLight1.position", pointLight1.position);
-        shader.setVec3("pointLight1.ambient", pointLight1.ambient);
-        shader.setVec3("pointLight1.diffuse", pointLight1.diffuse);
-        shader.setVec3("pointLight1.specular", pointLight1.specular);
-        shader.setFloat("pointLight1.constant", pointLight1.constant);
-        shader.setFloat("pointLight1.linear", pointLight1.linear);
-        shader.setFloat("pointLight1.quadratic", pointLight1.quadratic);
-        shader.setVec3("viewPosition", programState->camera.Position);
-        shader.setFloat("material.shininess", 32.0f);
-
-        shader.setVec3("pointLight2.position", pointLight2.position);
-        shader.setVec3("pointLight2.ambient", pointLight2.ambient);
-        shader.setVec3("pointLight2.diffuse", pointLight2.diffuse);
-        shader.setVec3("pointLight2.specular", pointLight2.specular);
-        shader.setFloat("pointLight2.constant", pointLight2.constant);
-        shader.setFloat("pointLight2.linear", pointLight2.linear);
-        shader.setFloat("pointLight2.quadratic", pointLight2.quadratic);
-        shader.setVec3("viewPosition", programState->camera.Position);
-        shader.setFloat("material.shininess", 32.0f);
-    }
-
-}
-
-// point lighting
-void lightIt(Shader shader, PointLight pointLight1, PointLight pointLight2, PointLight pointLight3, PointLight pointLight4, PointLight pointLight5, PointLight pointLight6) {
-    //treasure lighting
-    shader.use();
-    shader.setVec3("pointLight3.position", pointLight3.position);
-    shader.setVec3("pointLight3.ambient", pointLight3.ambient);
-    shader.setVec3("pointLight3.diffuse", pointLight3.diffuse);
-    shader.setVec3("pointLight3.specular", pointLight3.specular);
-    shader.setFloat("pointLight3.constant", pointLight3.constant);
-    shader.setFloat("pointLight3.linear", pointLight3.linear);
-    shader.setFloat("pointLight3.quadratic", pointLight3.quadratic);
-    shader.setVec3("viewPosition", programState->camera.Position);
-    shader.setFloat("material.shininess", 32.0f);
-
-    shader.setVec3("pointLight4.position", pointLight4.position);
-    shader.setVec3("pointLight4.ambient", pointLight4.ambient);
-    shader.setVec3("pointLight4.diffuse", pointLight4.diffuse);
-    shader.setVec3("pointLight4.specular", pointLight4.specular);
-    shader.setFloat("pointLight4.constant", pointLight4.constant);
-    shader.setFloat("pointLight4.linear", pointLight4.linear);
-    shader.setFloat("pointLight4.quadratic", pointLight4.quadratic);
-    shader.setVec3("viewPosition", programState->camera.Position);
-    shader.setFloat("material.shininess", 32.0f);
-
-
-    if(dayNnite) {
-        // Point light
-
-        shader.setVec3("pointLight1.position", pointLight1.position);
-        shader.setVec3("pointLight1.ambient", glm::vec3(0.0f, 0.0f, 0.0f));
-        shader.setVec3("pointLight1.diffuse", glm::vec3(0.0f, 0.0f, 0.0f));
-        shader.setVec3("pointLight1.specular", glm::vec3(0.0f, 0.0f, 0.0f));
-        shader.setFloat("pointLight1.constant", pointLight1.constant);
-        shader.setFloat("pointLight1.linear", pointLight1.linear);
-        shader.setFloat("pointLight1.quadratic", pointLight1.quadratic);
-        shader.setVec3("viewPosition", programState->camera.Position);
-        shader.setFloat("material.shininess", 32.0f);
-
-        shader.setVec3("pointLight2.position", pointLight2.position);
-        shader.setVec3("pointLight2.ambient", glm::vec3(0.0f, 0.0f, 0.0f));
-        shader.setVec3("pointLight2.diffuse", glm::vec3(0.0f, 0.0f, 0.0f));
-        shader.setVec3("pointLight2.specular", glm::vec3(0.0f, 0.0f, 0.0f));
-        shader.setFloat("pointLight2.constant", pointLight2.constant);
-        shader.setFloat("pointLight2.linear", pointLight2.linear);
-        shader.setFloat("pointLight2.quadratic", pointLight2.quadratic);
-        shader.setVec3("viewPosition", programState->camera.Position);
-        shader.setFloat("material.shininess", 32.0f);
-
-        shader.setVec3("pointLight5.position", pointLight5.position);
-        shader.setVec3("pointLight5.ambient", glm::vec3(0.0f, 0.0f, 0.0f));
-        shader.setVec3("pointLight5.diffuse", glm::vec3(0.0f, 0.0f, 0.0f));
-        shader.setVec3("pointLight5.specular", glm::vec3(0.0f, 0.0f, 0.0f));
-        shader.setFloat("pointLight5.constant", pointLight5.constant);
-        shader.setFloat("pointLight5.linear", pointLight5.linear);
-        shader.setFloat("pointLight5.quadratic", pointLight5.quadratic);
-        shader.setVec3("viewPosition", programState->camera.Position);
-        shader.setFloat("material.shininess", 32.0f);
-
-        shader.setVec3("pointLight6.position", pointLight6.position);
-        shader.setVec3("pointLight6.ambient", pointLight6.ambient);
-        shader.setVec3("pointLight6.diffuse", pointLight6.diffuse);
-        shader.setVec3("pointLight6.specular", pointLight6.specular);
-        shader.setFloat("pointLight6.constant", pointLight6.constant);
-        shader.setFloat("pointLight6.linear", pointLight6.linear);
-        shader.setFloat("pointLight6.quadratic", pointLight6.quadratic);
-        shader.setVec3("viewPosition", programState->camera.Position);
-        shader.setFloat("material.shininess", 32.0f);
-
-    }
-    else {
-        // Point light
-        shader.setVec3("pointLight1.position", pointLight1.position);
-        shader.setVec3("pointLight1.ambient", pointLight1.ambient);
-        shader.setVec3("pointLight1.diffuse", pointLight1.diffuse);
-        shader.setVec3("pointLight1.specular", pointLight1.specular);
-        shader.setFloat("pointLight1.constant", pointLight1.constant);
-        shader.setFloat("pointLight1.linear", pointLight1.linear);
-        shader.setFloat("pointLight1.quadratic", pointLight1.quadratic);
-        shader.setVec3("viewPosition", programState->camera.Position);
-        shader.setFloat("material.shininess", 32.0f);
-
-        shader.setVec3("pointLight2.position", pointLight2.position);
-        shader.setVec3("pointLight2.ambient", pointLight2.ambient);
-        shader.setVec3("pointLight2.diffuse", pointLight2.diffuse);
-        shader.setVec3("pointLight2.specular", pointLight2.specular);
-        shader.setFloat("pointLight2.constant", pointLight2.constant);
-        shader.setFloat("pointLight2.linear", pointLight2.linear);
-        shader.setFloat("pointLight2.quadratic", pointLight2.quadratic);
-        shader.setVec3("viewPosition", programState->camera.Position);
-        shader.setFloat("material.shininess", 32.0f);
-
-        shader.setVec3("pointLight5.position", pointLight5.position);
-        shader.setVec3("pointLight5.ambient", pointLight5.ambient);
-        shader.setVec3("pointLight5.diffuse", pointLight5.diffuse);
-        shader.setVec3("pointLight5.specular", pointLight5.specular);
-        shader.setFloat("pointLight5.constant", pointLight5.constant);
-        shader.setFloat("pointLight5.linear", pointLight5.linear);
-        shader.setFloat("pointLight5.quadratic", pointLight5.quadratic);
-        shader.setVec3("viewPosition", programState->camera.Position);
-        shader.setFloat("material.shininess", 32.0f);
-
-        shader.setVec3("pointLight6.position", pointLight6.position);
-        shader.setVec3("pointLight6.ambient", pointLight6.ambient);
-        shader.setVec3("pointLight6.diffuse", pointLight6.diffuse);
-        shader.setVec3("pointLight6.specular", pointLight6.specular);
-        shader.setFloat("pointLight6.constant", pointLight6.constant);
-        shader.setFloat("pointLight6.linear", pointLight6.linear);
-        shader.setFloat("pointLight6.quadratic", pointLight6.quadratic);
-        shader.setVec3("viewPosition", programState->camera.Position);
-        shader.setFloat("material.shininess", 32.0f);
-    }
-}
-
 // renders a 1x1 quad in NDC with manually calculated tangent vectors
 // ------------------------------------------------------------------
 unsigned int quadVAO = 0;
@@ -1215,7 +1608,7 @@ void renderQuad()
         // configure plane VAO
         glGenVertexArrays(1, &quadVAO);
         glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
+        glState().bindVertexArray(quadVAO);
         glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
         glEnableVertexAttribArray(0);
@@ -1231,7 +1624,21 @@ void renderQuad()
     }
 
 
-    glBindVertexArray(quadVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
+    glState().bindVertexArray(quadVAO);
+    renderStats().drawArrays(GL_TRIANGLES, 0, 6);
+}
+
+bool hasArgument(int argc, char *argv[], const char *name) {
+    for (int i = 1; i < argc; i++)
+        if (std::strcmp(argv[i], name) == 0)
+            return true;
+    return false;
+}
+
+// the argument following name, null if name isn't given or is the last argument
+const char *argumentValue(int argc, char *argv[], const char *name) {
+    for (int i = 1; i + 1 < argc; i++)
+        if (std::strcmp(argv[i], name) == 0)
+            return argv[i + 1];
+    return nullptr;
 }
\ No newline at end of file